@@ -0,0 +1,411 @@
+//
+// Running a machine at compile time is only half of the story -- the other
+// half is how long the compiler takes to do it and how much memory it eats up
+// while at it. This program generates families of machines of growing size,
+// compiles each of them with the given compilers, and records how long each
+// compilation took and how much memory the compiler needed at its peak.
+//
+// The families are:
+//   counter       The binary to unary converter from turing-machine.cpp,
+//                 counting down from 1, 2, 4, ... -- the steps grow
+//                 quadratically with the size.
+//   reversal      The input reversal machine on inputs of growing length.
+//   instructions  A chain of 10 to 1000 states with one instruction each,
+//                 walked from one end to the other.
+//
+// Each of them is compiled once for the type engine (run<>) and once for the
+// constexpr engine (run_constexpr<>). The results are written to the standard
+// output as CSV, one row for each compilation, so that steps or instructions
+// can be plotted against compile time. Compilers whose name mentions clang
+// are also asked for -ftime-trace, from which the number of template
+// instantiations is taken.
+//
+// A compilation that fails gets a row all the same, with "failed" in place
+// of its compile time.
+//
+// Given the CSV of an earlier run with --baseline, compilations that got
+// slower by more than the tolerance (25 % unless given by --tolerance), or
+// that failed where they used to succeed, are reported, and the program
+// exits with status 1 if there were any.
+//
+// Compile with
+//   $CXX -Wall -Wextra -std=c++17 -pedantic compile-benchmark.cpp -o compile-benchmark
+// and run it from this directory as
+//   ./compile-benchmark [--baseline FILE] [--tolerance T] [compiler...]
+// It needs a POSIX system to spawn the compilers on.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+//
+// The machines: Each is generated as the source of a program that includes
+// turing-machine.cpp. Compiled normally, the program runs the machine on the
+// engine being measured. Compiled with COUNT_STEPS, it runs the machine on
+// the runtime engine instead and prints how many steps it made.
+//
+
+struct generated_machine {
+  std::vector<std::string> states;   // Non-final states, then final ones
+  std::size_t finals = 0;            // How many of the states are final
+  std::vector<std::string> instructions;
+  std::string start;
+  std::string input;
+};
+
+std::string
+instruction(std::string const& from, char read, std::string const& to,
+            char write, char move) {
+  std::ostringstream out;
+  out << "instruction<" << from << ", '" << read << "', " << to << ", '"
+      << write << "', '" << move << "'>";
+  return out.str();
+}
+
+generated_machine
+counter(std::size_t value) {
+  generated_machine m;
+  m.states = {"find_lsb", "decrement", "tally", "back", "zero_out", "done"};
+  m.finals = 1;
+  m.instructions = {
+    instruction("find_lsb",  '|', "decrement", '|', 'L'),
+    instruction("find_lsb",  '?', "find_lsb",  '?', 'R'),
+    instruction("decrement", '1', "tally",     '0', 'R'),
+    instruction("decrement", '0', "decrement", '1', 'L'),
+    instruction("decrement", '#', "zero_out",  '#', 'R'),
+    instruction("tally",     '#', "back",      '1', 'L'),
+    instruction("tally",     '?', "tally",     '?', 'R'),
+    instruction("back",      '|', "decrement", '|', 'L'),
+    instruction("back",      '?', "back",      '?', 'L'),
+    instruction("zero_out",  '1', "zero_out",  '0', 'R'),
+    instruction("zero_out",  '|', "done",      '|', '0')
+  };
+  m.start = "find_lsb";
+
+  for (; value > 0; value /= 2)
+    m.input.insert(m.input.begin(), value % 2 ? '1' : '0');
+  m.input += '|';
+  return m;
+}
+
+generated_machine
+reversal(std::size_t length) {
+  generated_machine m;
+  m.states = {
+    "put_right_marker", "rewind", "go_right_a", "go_right_b", "go_left_a",
+    "go_left_b", "take_left", "take_right", "clear", "clear_a", "clear_b",
+    "clear_last", "end"
+  };
+  m.finals = 1;
+  m.instructions = {
+    instruction("put_right_marker", '#', "rewind",           '|', 'L'),
+    instruction("put_right_marker", '?', "put_right_marker", '?', 'R'),
+    instruction("rewind",           '#', "take_left",        '#', 'R'),
+    instruction("rewind",           '?', "rewind",           '?', 'L'),
+    instruction("take_left",        'a', "go_right_a",       '|', 'R'),
+    instruction("take_left",        'b', "go_right_b",       '|', 'R'),
+    instruction("take_left",        '|', "clear",            '|', 'R'),
+    instruction("go_right_a",       '|', "take_right",       'a', 'L'),
+    instruction("go_right_b",       '|', "take_right",       'b', 'L'),
+    instruction("go_right_a",       '?', "go_right_a",       '?', 'R'),
+    instruction("go_right_b",       '?', "go_right_b",       '?', 'R'),
+    instruction("take_right",       'a', "go_left_a",        '|', 'L'),
+    instruction("take_right",       'b', "go_left_b",        '|', 'L'),
+    instruction("take_right",       '|', "clear",            '|', 'R'),
+    instruction("go_left_a",        '|', "take_left",        'a', 'R'),
+    instruction("go_left_b",        '|', "take_left",        'b', 'R'),
+    instruction("go_left_a",        '?', "go_left_a",        '?', 'L'),
+    instruction("go_left_b",        '?', "go_left_b",        '?', 'L'),
+    instruction("clear",            'a', "clear_a",          '|', 'L'),
+    instruction("clear",            'b', "clear_b",          '|', 'L'),
+    instruction("clear",            '|', "clear",            '|', 'R'),
+    instruction("clear",            '#', "clear_last",       '#', 'L'),
+    instruction("clear_a",          '|', "clear",            'a', 'R'),
+    instruction("clear_b",          '|', "clear",            'b', 'R'),
+    instruction("clear_last",       '|', "end",              '#', '0')
+  };
+  m.start = "put_right_marker";
+
+  for (std::size_t i = 0; i < length; ++i)
+    m.input += i % 3 == 0 ? 'b' : 'a';
+  return m;
+}
+
+generated_machine
+instructions(std::size_t count) {
+  generated_machine m;
+  for (std::size_t i = 0; i < count; ++i)
+    m.states.push_back("s" + std::to_string(i));
+  m.states.push_back("done");
+  m.finals = 1;
+
+  for (std::size_t i = 0; i < count; ++i)
+    m.instructions.push_back(
+      instruction(m.states[i], '?', m.states[i + 1], '?', 'R')
+    );
+  m.start = "s0";
+  return m;
+}
+
+std::string
+source(generated_machine const& m, std::string const& engine) {
+  std::ostringstream out;
+  out << "#define TURING_MACHINE_NO_MAIN\n"
+      << "#include \"turing-machine.cpp\"\n\n"
+      << "// In a namespace, so that the states can't clash with the library.\n"
+      << "namespace generated {\n";
+
+  for (std::size_t i = 0; i < m.states.size(); ++i)
+    out << "struct " << m.states[i] << " : state<"
+        << (i + m.finals >= m.states.size() ? "true" : "") << "> { };\n";
+
+  out << "\nusing bench_prog = program<\n";
+  for (std::size_t i = 0; i < m.instructions.size(); ++i)
+    out << "  " << m.instructions[i]
+        << (i + 1 < m.instructions.size() ? ",\n" : "\n");
+  out << ">;\n"
+      << "}  // end namespace generated\n\n";
+
+  out << "#ifdef COUNT_STEPS\n"
+      << "int main() {\n"
+      << "  std::cout << run_runtime<\n"
+      << "    generated::" << m.start << ", generated::bench_prog\n"
+      << "  >::do_(\n"
+      << "    runtime_tape{\"" << m.input << "\"}\n"
+      << "  ).steps << '\\n';\n"
+      << "}\n"
+      << "#else\n"
+      << "using bench_tape = make_tape<";
+  for (std::size_t i = 0; i < m.input.size(); ++i)
+    out << (i ? ", '" : "'") << m.input[i] << '\'';
+  out << ">::type;\n"
+      << "using bench_result = " << engine << "::run<\n"
+      << "  machine<generated::" << m.start
+      << ", bench_tape, generated::bench_prog>\n"
+      << ">::result;\n"
+      << "#endif\n";
+  return out.str();
+}
+
+//
+// Measuring: The compilers are spawned directly, so that their own resource
+// usage can be told apart from that of anything else.
+//
+
+struct measurement {
+  bool ok = false;
+  double seconds = 0.0;
+  long peak_rss_kb = 0;
+};
+
+measurement
+spawn(std::vector<std::string> const& command) {
+  std::vector<char*> argv;
+  for (std::string const& arg : command)
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  measurement result;
+  auto const start = std::chrono::steady_clock::now();
+  pid_t const pid = fork();
+  if (pid < 0)
+    return result;
+  if (pid == 0) {
+    execvp(argv[0], argv.data());
+    std::perror(argv[0]);
+    _exit(127);
+  }
+
+  int status = 0;
+  rusage usage{};
+  if (wait4(pid, &status, 0, &usage) != pid)
+    return result;
+
+  std::chrono::duration<double> const elapsed =
+    std::chrono::steady_clock::now() - start;
+  result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  result.seconds = elapsed.count();
+  result.peak_rss_kb = usage.ru_maxrss;
+  return result;
+}
+
+// Number of template instantiations recorded in a -ftime-trace file.
+std::size_t
+count_instantiations(fs::path const& trace) {
+  std::ifstream in{trace};
+  std::string const text{std::istreambuf_iterator<char>{in}, {}};
+
+  std::size_t count = 0;
+  for (char const* event : {"\"InstantiateClass\"", "\"InstantiateFunction\""})
+    for (std::size_t at = text.find(event); at != std::string::npos;
+         at = text.find(event, at + 1))
+      ++count;
+  return count;
+}
+
+// Steps made by the machine, taken from a run on the runtime engine.
+std::size_t
+count_steps(std::string const& compiler, std::string const& include,
+            fs::path const& file, fs::path const& binary) {
+  measurement const build = spawn({
+    compiler, "-std=c++17", "-pthread", "-DCOUNT_STEPS", "-I", include,
+    file.string(), "-o", binary.string()
+  });
+  if (!build.ok)
+    return 0;
+
+  std::size_t steps = 0;
+  if (FILE* out = popen(binary.c_str(), "r")) {
+    unsigned long long n = 0;
+    if (std::fscanf(out, "%llu", &n) == 1)
+      steps = n;
+    pclose(out);
+  }
+  return steps;
+}
+
+//
+// Baseline: Rows of an earlier run, keyed by compiler, engine, family and
+// size, with the compile time in seconds. Failed compilations have no time
+// to compare with and are left out.
+//
+
+using row_key = std::tuple<std::string, std::string, std::string, std::size_t>;
+
+std::map<row_key, double>
+read_baseline(std::string const& path) {
+  std::map<row_key, double> result;
+  std::ifstream in{path};
+  std::string line;
+  std::getline(in, line);  // Header
+
+  while (std::getline(in, line)) {
+    std::vector<std::string> fields;
+    std::istringstream row{line};
+    for (std::string field; std::getline(row, field, ','); )
+      fields.push_back(field);
+    if (fields.size() < 7 || fields[6] == "failed")
+      continue;
+
+    result[{fields[0], fields[1], fields[2], std::stoul(fields[3])}] =
+      std::stod(fields[6]);
+  }
+  return result;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> compilers;
+  std::map<row_key, double> baseline;
+  double tolerance = 0.25;
+  for (int i = 1; i < argc; ++i) {
+    std::string const arg = argv[i];
+    if (arg == "--baseline" && i + 1 < argc)
+      baseline = read_baseline(argv[++i]);
+    else if (arg == "--tolerance" && i + 1 < argc)
+      tolerance = std::stod(argv[++i]);
+    else
+      compilers.push_back(arg);
+  }
+  if (compilers.empty())
+    compilers.push_back("g++");
+
+  std::string const include =
+    fs::absolute(fs::path{__FILE__}).parent_path().string();
+  fs::path const dir =
+    fs::temp_directory_path() / ("compile-benchmark-" + std::to_string(getpid()));
+  fs::create_directories(dir);
+
+  struct family {
+    char const* name;
+    generated_machine (*generate)(std::size_t);
+    std::vector<std::size_t> sizes;
+  };
+  std::vector<family> const families{
+    {"counter", counter, {1, 2, 4, 8, 16, 32, 64}},
+    {"reversal", reversal, {1, 2, 4, 8, 16, 32, 64}},
+    {"instructions", instructions, {10, 20, 50, 100, 200, 500, 1000}}
+  };
+  std::vector<std::pair<char const*, char const*>> const engines{
+    {"type", "type_engine"},
+    {"constexpr", "constexpr_engine<>"}
+  };
+
+  std::cout << "compiler,engine,family,size,instructions,steps,seconds,"
+               "peak_rss_kb,instantiations\n";
+
+  bool regressed = false;
+  for (std::string const& compiler : compilers)
+    for (auto const& [engine, engine_type] : engines)
+      for (family const& f : families)
+        for (std::size_t size : f.sizes) {
+          generated_machine const m = f.generate(size);
+          fs::path const file =
+            dir / (f.name + std::string{"-"} + std::to_string(size) + ".cpp");
+          fs::path const object = fs::path{file}.replace_extension(".o");
+          std::ofstream{file} << source(m, engine_type);
+
+          std::vector<std::string> command{
+            compiler, "-std=c++17", "-I", include, "-c", file.string(),
+            "-o", object.string()
+          };
+          bool const traced = compiler.find("clang") != std::string::npos;
+          if (traced)
+            command.push_back("-ftime-trace");
+
+          measurement const compiled = spawn(command);
+          auto const old = baseline.find({compiler, engine, f.name, size});
+          if (!compiled.ok) {
+            std::cerr << compiler << " failed on " << file << '\n';
+            std::cout << compiler << ',' << engine << ',' << f.name << ','
+                      << size << ',' << m.instructions.size() << ",,failed,"
+                      << compiled.peak_rss_kb << ',' << std::endl;
+            if (old != baseline.end()) {
+              std::cerr << compiler << ", " << engine << " engine, " << f.name
+                        << ' ' << size << ": " << old->second
+                        << " s -> failed\n";
+              regressed = true;
+            }
+            continue;
+          }
+
+          std::size_t const steps = count_steps(
+            compiler, include, file, fs::path{file}.replace_extension()
+          );
+
+          std::cout << compiler << ',' << engine << ',' << f.name << ','
+                    << size << ',' << m.instructions.size() << ',' << steps
+                    << ',' << compiled.seconds << ','
+                    << compiled.peak_rss_kb << ',';
+          if (traced)
+            std::cout << count_instantiations(
+              fs::path{object}.replace_extension(".json")
+            );
+          std::cout << std::endl;
+
+          if (old != baseline.end()
+              && compiled.seconds > old->second * (1 + tolerance)) {
+            std::cerr << compiler << ", " << engine << " engine, " << f.name
+                      << ' ' << size << ": " << old->second << " s -> "
+                      << compiled.seconds << " s\n";
+            regressed = true;
+          }
+        }
+
+  fs::remove_all(dir);
+  return regressed ? 1 : 0;
+}
@@ -6,12 +6,19 @@
 // we're going to do here.
 //
 // Compile with
-//   $CXX -Wall -Wextra -std=c++11 -pedantic mu-recursive-functions.cpp -o mu-recursive-functions
-// I've tested this with $CXX = g++ 4.8.1 and clang++ 3.3.
+//   $CXX -Wall -Wextra -std=c++14 -pedantic mu-recursive-functions.cpp -o mu-recursive-functions
+// It needs C++14 and a recent compiler; I've tested it with $CXX = g++ 12.
 //
 
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 //
 // Elementary functions:
@@ -34,23 +41,28 @@ struct successor {
 // The projection function scheme:
 // For all natural I, K, such that 1 <= I <= K:
 //   projection_I(x_1, x_2, ..., x_K) = x_I
-template <unsigned I>
-struct projection {
-  template <unsigned First, unsigned... Rest>
-  struct fun { 
-    static_assert(sizeof...(Rest) + 1 >= I, "Invalid projection");
+namespace detail {
+  template <unsigned I, unsigned... Xs>
+  struct projection_fun;
+
+  template <unsigned I, unsigned First, unsigned... Rest>
+  struct projection_fun<I, First, Rest...> {
+    static_assert(sizeof...(Rest) >= I, "Invalid projection");
 
-    static constexpr unsigned 
-    value = projection<I - 1>::template fun<Rest...>::value; 
+    static constexpr unsigned
+    value = projection_fun<I - 1, Rest...>::value;
   };
-};
 
-template <>
-struct projection<0> {
   template <unsigned X, unsigned... Rest>
-  struct fun {
-    static constexpr unsigned value = X; 
+  struct projection_fun<0, X, Rest...> {
+    static constexpr unsigned value = X;
   };
+} // end namespace detail
+
+template <unsigned I>
+struct projection {
+  template <unsigned... Xs>
+  using fun = detail::projection_fun<I, Xs...>;
 };
 
 //
@@ -63,16 +75,35 @@ struct projection<0> {
 // substitution(h, g_1, ..., g_m) =
 //   = f(x_1, ..., x_k) = 
 //   = h(g_1(x_1, ..., x_k), g_2(x_1, ..., x_k), ..., g_m(x_1, ..., x_k))
+namespace detail {
+  template <template <unsigned...> class... Fs>
+  struct functions { };
+
+  template <
+    template <unsigned...> class H,
+    class Gs,
+    unsigned... Xs
+  >
+  struct substitution_fun;
+
+  template <
+    template <unsigned...> class H,
+    template <unsigned...> class... Gs,
+    unsigned... Xs
+  >
+  struct substitution_fun<H, functions<Gs...>, Xs...> {
+    static constexpr unsigned
+    value = H<Gs<Xs...>::value...>::value;
+  };
+} // end namespace detail
+
 template <
   template <unsigned...> class H,
   template <unsigned...> class... Gs
 >
 struct substitution {
   template <unsigned... Xs>
-  struct fun {
-    static constexpr unsigned
-    value = H<Gs<Xs...>::value...>::value;
-  };
+  using fun = detail::substitution_fun<H, detail::functions<Gs...>, Xs...>;
 };
 
 // Promitive recursion operator:
@@ -142,6 +173,17 @@ namespace detail {
   struct minimisation_helper<Z, F, true, Xs...> {
     static constexpr unsigned value = Z;
   };
+
+  template <
+    template <unsigned...> class F,
+    unsigned... Xs
+  >
+  struct minimisation_fun {
+    static constexpr unsigned
+    value = minimisation_helper<
+      0, F, F<0, Xs...>::value == 0, Xs...
+    >::value;
+  };
 } // end namespace detail
 
 template <
@@ -149,12 +191,7 @@ template <
 >
 struct minimisation {
   template <unsigned... Xs>
-  struct fun {
-    static constexpr unsigned 
-    value = detail::minimisation_helper<
-      0, F, F<0, Xs...>::value == 0, Xs...
-    >::value;
-  };
+  using fun = detail::minimisation_fun<F, Xs...>;
 };
 
 // 
@@ -162,19 +199,23 @@ struct minimisation {
 //
 
 // constant_N(x_1, ..., x_k) := N
-template <unsigned N>
-struct constant {
-  template <unsigned... Xs>
-  struct fun {
+namespace detail {
+  template <unsigned N, unsigned... Xs>
+  struct constant_fun {
     static constexpr unsigned
-    value = successor<constant<N - 1>::template fun<Xs...>::value>::value;
+    value = successor<constant_fun<N - 1, Xs...>::value>::value;
   };
-};
 
-template <>
-struct constant<0> {
   template <unsigned... Xs>
-  using fun = zero<Xs...>;
+  struct constant_fun<0, Xs...> {
+    static constexpr unsigned value = zero<Xs...>::value;
+  };
+} // end namespace detail
+
+template <unsigned N>
+struct constant {
+  template <unsigned... Xs>
+  using fun = detail::constant_fun<N, Xs...>;
 };
 
 // sum(x, y) := x + y
@@ -299,10 +340,789 @@ using sqrt =
     >::fun
   >::fun<X>;
 
+//
+// Evaluation with loops:
+//
+// Computing recursion<G, H>::fun<Y, ...> above instantiates Y + 1
+// recursion_helpers, constant<N> is N successors deep, and minimisation
+// instantiates a helper for every candidate it tries -- so sum<2000, 1> runs
+// into the compiler's template depth limit long before it gets hard to
+// compute. evaluate<F, Xs...> gives the same F(Xs...) without instantiating
+// F at those arguments. F is only ever named with zeros as arguments, which
+// tells us what it is made of without computing anything; that becomes a tree
+// of the nodes below, which constexpr functions then evaluate with loops --
+// f(0) up to f(y) for recursion, one candidate after another for
+// minimisation. The template depth is that of the tree, whatever the
+// arguments.
+//
+// This needs C++14 for the loops.
+//
+namespace detail {
+  // eval takes a pointer to the node's arguments. K is the arity of the
+  // function the node computes.
+  struct zero_node {
+    static constexpr unsigned
+    eval(unsigned const*) { return 0; }
+  };
+
+  struct successor_node {
+    static constexpr unsigned
+    eval(unsigned const* xs) { return xs[0] + 1; }
+  };
+
+  template <unsigned I>
+  struct projection_node {
+    static constexpr unsigned
+    eval(unsigned const* xs) { return xs[I]; }
+  };
+
+  template <unsigned N>
+  struct constant_node {
+    static constexpr unsigned
+    eval(unsigned const*) { return N; }
+  };
+
+  template <class H, class... Gs>
+  struct substitution_node {
+    static constexpr unsigned
+    eval(unsigned const* xs) {
+      unsigned const ys[] = {Gs::eval(xs)..., 0u};
+      return H::eval(ys);
+    }
+  };
+
+  template <unsigned K, class G, class H>
+  struct recursion_node {
+    static constexpr unsigned
+    eval(unsigned const* xs) {
+      // ys = (y, f(y, x_1, ..., x_k), x_1, ..., x_k)
+      unsigned ys[K + 2] = {};
+      for (unsigned i = 0; i < K; ++i)
+        ys[i + 2] = xs[i + 1];
+
+      ys[1] = G::eval(ys + 2);
+      for (; ys[0] < xs[0]; ++ys[0])
+        ys[1] = H::eval(ys);
+      return ys[1];
+    }
+  };
+
+  template <unsigned K, class F>
+  struct minimisation_node {
+    static constexpr unsigned
+    eval(unsigned const* xs) {
+      // ys = (z, x_1, ..., x_k)
+      unsigned ys[K + 1] = {};
+      for (unsigned i = 0; i < K; ++i)
+        ys[i + 1] = xs[i];
+
+      while (F::eval(ys) != 0)
+        ++ys[0];
+      return ys[0];
+    }
+  };
+
+  // F<0, ..., 0> with K zeros. Only the name of the type is used, so its value
+  // is never computed.
+  template <template <unsigned...> class F, unsigned K, unsigned... Zeros>
+  struct applied_to_zeros : applied_to_zeros<F, K - 1, 0, Zeros...> { };
+
+  template <template <unsigned...> class F, unsigned... Zeros>
+  struct applied_to_zeros<F, 0, Zeros...> {
+    using type = F<Zeros...>;
+  };
+
+  // Left undefined for anything not built from the combinators above.
+  template <class Application>
+  struct node_of;
+
+  // The tree of the K-ary function F.
+  template <template <unsigned...> class F, unsigned K>
+  using tree = typename node_of<typename applied_to_zeros<F, K>::type>::type;
+
+  template <unsigned... Xs>
+  struct node_of<zero<Xs...>> {
+    using type = zero_node;
+  };
+
+  template <unsigned X>
+  struct node_of<successor<X>> {
+    using type = successor_node;
+  };
+
+  template <unsigned I, unsigned... Xs>
+  struct node_of<projection_fun<I, Xs...>> {
+    using type = projection_node<I>;
+  };
+
+  template <unsigned N, unsigned... Xs>
+  struct node_of<constant_fun<N, Xs...>> {
+    using type = constant_node<N>;
+  };
+
+  template <
+    template <unsigned...> class H,
+    template <unsigned...> class... Gs,
+    unsigned... Xs
+  >
+  struct node_of<substitution_fun<H, functions<Gs...>, Xs...>> {
+    using type = substitution_node<
+      tree<H, sizeof...(Gs)>, tree<Gs, sizeof...(Xs)>...
+    >;
+  };
+
+  template <
+    template <unsigned...> class G,
+    template <unsigned...> class H,
+    int Y, int... Xs
+  >
+  struct node_of<recursion_helper<G, H, Y, Xs...>> {
+    using type = recursion_node<
+      sizeof...(Xs), tree<G, sizeof...(Xs)>, tree<H, sizeof...(Xs) + 2>
+    >;
+  };
+
+  template <template <unsigned...> class F, unsigned... Xs>
+  struct node_of<minimisation_fun<F, Xs...>> {
+    using type = minimisation_node<sizeof...(Xs), tree<F, sizeof...(Xs) + 1>>;
+  };
+} // end namespace detail
+
+//
+// Strength reduction:
+//
+// Evaluated faithfully, sum(x, y) is x successors, mul(x, y) is a sum for
+// each unit of x, and square and sqrt are built on mul, so they slow down
+// quadratically. detail::lowered<Tree> works through a tree from the leaves
+// up. It recognises the subtrees that sum, pred, sub1, sub, mul, sgn, cosgn,
+// lt, gt, eq and square become and replaces each with a native_node, which
+// computes the function with a machine operation. Recognition goes by shape,
+// not by name, so a function defined the same way elsewhere gets lowered too.
+// Anything it doesn't recognise is kept and evaluated faithfully. Unsigned
+// arithmetic wraps the same way a chain of successors does, so lowering
+// doesn't change any value.
+//
+// evaluate<> and runtime_function::of<>() evaluate the lowered tree;
+// evaluate_faithfully<> and runtime_function::faithful<>() evaluate the tree
+// as defined. main() checks that they agree.
+//
+namespace detail {
+  enum class native_op {
+    sum, pred, sub1, sub, mul, sgn, cosgn, lt, gt, eq, square
+  };
+
+  constexpr unsigned
+  native(native_op op, unsigned const* xs) {
+    switch (op) {
+    case native_op::sum:    return xs[0] + xs[1];
+    case native_op::pred:   return xs[0] > 0 ? xs[0] - 1 : 0;
+    case native_op::sub1:   return xs[1] > xs[0] ? xs[1] - xs[0] : 0;
+    case native_op::sub:    return xs[0] > xs[1] ? xs[0] - xs[1] : 0;
+    case native_op::mul:    return xs[0] * xs[1];
+    case native_op::sgn:    return xs[0] != 0;
+    case native_op::cosgn:  return xs[0] == 0;
+    case native_op::lt:     return xs[0] < xs[1];
+    case native_op::gt:     return xs[0] > xs[1];
+    case native_op::eq:     return xs[0] == xs[1];
+    case native_op::square: return xs[0] * xs[0];
+    }
+    return 0;
+  }
+
+  template <native_op Op>
+  struct native_node {
+    static constexpr unsigned
+    eval(unsigned const* xs) { return native(Op, xs); }
+  };
+
+  // A node whose operands have been lowered already; a native_node if it's a
+  // shape we know, the node itself otherwise.
+  template <class Node>
+  struct lower {
+    using type = Node;
+  };
+
+  // sum = recursion(projection_0, substitution(successor, projection_1))
+  template <>
+  struct lower<
+    recursion_node<
+      1, projection_node<0>,
+      substitution_node<successor_node, projection_node<1>>
+    >
+  > {
+    using type = native_node<native_op::sum>;
+  };
+
+  // pred = recursion(zero, projection_0)
+  template <>
+  struct lower<recursion_node<0, zero_node, projection_node<0>>> {
+    using type = native_node<native_op::pred>;
+  };
+
+  // sub1 = recursion(projection_0, substitution(pred, projection_1))
+  template <>
+  struct lower<
+    recursion_node<
+      1, projection_node<0>,
+      substitution_node<native_node<native_op::pred>, projection_node<1>>
+    >
+  > {
+    using type = native_node<native_op::sub1>;
+  };
+
+  // sub = substitution(sub1, projection_1, projection_0)
+  template <>
+  struct lower<
+    substitution_node<
+      native_node<native_op::sub1>, projection_node<1>, projection_node<0>
+    >
+  > {
+    using type = native_node<native_op::sub>;
+  };
+
+  // mul = recursion(zero, substitution(sum, projection_1, projection_2))
+  template <>
+  struct lower<
+    recursion_node<
+      1, zero_node,
+      substitution_node<
+        native_node<native_op::sum>, projection_node<1>, projection_node<2>
+      >
+    >
+  > {
+    using type = native_node<native_op::mul>;
+  };
+
+  // sgn = recursion(zero, constant_1)
+  template <>
+  struct lower<recursion_node<0, zero_node, constant_node<1>>> {
+    using type = native_node<native_op::sgn>;
+  };
+
+  // cosgn = recursion(constant_1, zero)
+  template <>
+  struct lower<recursion_node<0, constant_node<1>, zero_node>> {
+    using type = native_node<native_op::cosgn>;
+  };
+
+  // lt = substitution(sgn, substitution(sub, projection_1, projection_0))
+  template <>
+  struct lower<
+    substitution_node<
+      native_node<native_op::sgn>,
+      substitution_node<
+        native_node<native_op::sub>, projection_node<1>, projection_node<0>
+      >
+    >
+  > {
+    using type = native_node<native_op::lt>;
+  };
+
+  // gt = substitution(sgn, sub)
+  template <>
+  struct lower<
+    substitution_node<
+      native_node<native_op::sgn>, native_node<native_op::sub>
+    >
+  > {
+    using type = native_node<native_op::gt>;
+  };
+
+  // eq = substitution(cosgn, substitution(sum, lt, gt))
+  template <>
+  struct lower<
+    substitution_node<
+      native_node<native_op::cosgn>,
+      substitution_node<
+        native_node<native_op::sum>,
+        native_node<native_op::lt>, native_node<native_op::gt>
+      >
+    >
+  > {
+    using type = native_node<native_op::eq>;
+  };
+
+  // square = substitution(mul, projection_0, projection_0)
+  template <>
+  struct lower<
+    substitution_node<
+      native_node<native_op::mul>, projection_node<0>, projection_node<0>
+    >
+  > {
+    using type = native_node<native_op::square>;
+  };
+
+  template <class Tree>
+  struct lowered {
+    using type = Tree;
+  };
+
+  template <class H, class... Gs>
+  struct lowered<substitution_node<H, Gs...>> {
+    using type = typename lower<
+      substitution_node<
+        typename lowered<H>::type, typename lowered<Gs>::type...
+      >
+    >::type;
+  };
+
+  template <unsigned K, class G, class H>
+  struct lowered<recursion_node<K, G, H>> {
+    using type = typename lower<
+      recursion_node<
+        K, typename lowered<G>::type, typename lowered<H>::type
+      >
+    >::type;
+  };
+
+  template <unsigned K, class F>
+  struct lowered<minimisation_node<K, F>> {
+    using type = typename lower<
+      minimisation_node<K, typename lowered<F>::type>
+    >::type;
+  };
+
+  template <template <unsigned...> class F, unsigned K>
+  using lowered_tree = typename lowered<tree<F, K>>::type;
+
+  template <class Tree, unsigned... Xs>
+  constexpr unsigned
+  evaluate_tree() {
+    unsigned const xs[] = {Xs..., 0u};
+    return Tree::eval(xs);
+  }
+} // end namespace detail
+
+template <template <unsigned...> class F, unsigned... Xs>
+struct evaluate {
+  static constexpr unsigned
+  value = detail::evaluate_tree<
+    detail::lowered_tree<F, sizeof...(Xs)>, Xs...
+  >();
+};
+
+template <template <unsigned...> class F, unsigned... Xs>
+struct evaluate_faithfully {
+  static constexpr unsigned
+  value = detail::evaluate_tree<detail::tree<F, sizeof...(Xs)>, Xs...>();
+};
+
+//
+// Evaluation at runtime:
+//
+// Everything so far is computed by the compiler, for arguments known at
+// compile time. runtime_function::of<F, K>() turns the lowered tree of the
+// K-ary function F (runtime_function::faithful<F, K>() the tree as defined)
+// into nodes in a vector, which can then be evaluated on arguments known only
+// at runtime. Recursion is again a loop from f(0) up to f(y).
+//
+// On top of that, results are remembered in a memo table: the value of every
+// recursion and minimisation computed, and every memo_stride-th step of every
+// recursion loop. Asking for f(y, ...) again is then a lookup, and asking for
+// f(y + d, ...) resumes from the last step remembered below it instead of
+// starting from f(0) -- which, for one thing, makes a faithful
+// mul(x, y) = sum(mul(x - 1, y), y) linear rather than quadratic in x, since
+// each sum picks up where the previous one left off. The table has a fixed
+// number of slots, each holding whatever was last stored in it, so it stays
+// the same size however much gets computed. Only functions of at most
+// memo_arity arguments are remembered.
+//
+// A runtime_function is not safe to call from several threads at once: the
+// memo table and the stack of arguments are shared by its calls.
+//
+namespace detail {
+  struct runtime_node {
+    enum kind_type {
+      zero, successor, projection, constant,
+      substitution, recursion, minimisation, native
+    };
+
+    kind_type kind;
+    unsigned value;       // I of a projection, N of a constant, the
+                          // native_op of a native node, K otherwise
+    std::size_t first;    // Operands, as indices into runtime_tree::operands
+    std::size_t count;
+  };
+
+  struct runtime_tree {
+    std::vector<runtime_node> nodes;
+    std::vector<std::size_t> operands;
+
+    std::size_t
+    add(runtime_node::kind_type kind, unsigned value,
+        std::initializer_list<std::size_t> children = {}) {
+      nodes.push_back({kind, value, operands.size(), children.size()});
+      operands.insert(operands.end(), children);
+      return nodes.size() - 1;
+    }
+
+    std::size_t
+    operand(runtime_node const& node, std::size_t i) const {
+      return operands[node.first + i];
+    }
+  };
+
+  // Appends the nodes of a tree, operands first, and returns the index of its
+  // root.
+  inline std::size_t
+  emit(runtime_tree& t, zero_node) {
+    return t.add(runtime_node::zero, 0);
+  }
+
+  inline std::size_t
+  emit(runtime_tree& t, successor_node) {
+    return t.add(runtime_node::successor, 0);
+  }
+
+  template <unsigned I>
+  std::size_t
+  emit(runtime_tree& t, projection_node<I>) {
+    return t.add(runtime_node::projection, I);
+  }
+
+  template <unsigned N>
+  std::size_t
+  emit(runtime_tree& t, constant_node<N>) {
+    return t.add(runtime_node::constant, N);
+  }
+
+  template <native_op Op>
+  std::size_t
+  emit(runtime_tree& t, native_node<Op>) {
+    return t.add(runtime_node::native, unsigned(Op));
+  }
+
+  template <class H, class... Gs>
+  std::size_t
+  emit(runtime_tree& t, substitution_node<H, Gs...>) {
+    return t.add(
+      runtime_node::substitution, sizeof...(Gs),
+      {emit(t, H{}), emit(t, Gs{})...}
+    );
+  }
+
+  template <unsigned K, class G, class H>
+  std::size_t
+  emit(runtime_tree& t, recursion_node<K, G, H>) {
+    return t.add(runtime_node::recursion, K, {emit(t, G{}), emit(t, H{})});
+  }
+
+  template <unsigned K, class F>
+  std::size_t
+  emit(runtime_tree& t, minimisation_node<K, F>) {
+    return t.add(runtime_node::minimisation, K, {emit(t, F{})});
+  }
+} // end namespace detail
+
+class runtime_function {
+public:
+  static constexpr std::size_t memo_arity = 4;
+  static constexpr unsigned memo_stride = 64;
+
+  // F, taking K arguments, with a memo table of memo_slots slots rounded up
+  // to a power of two; 0 turns remembering off.
+  template <template <unsigned...> class F, unsigned K>
+  static runtime_function
+  of(std::size_t memo_slots = 1 << 16) {
+    return make<detail::lowered_tree<F, K>>(K, memo_slots);
+  }
+
+  // The same, without lowering any of it.
+  template <template <unsigned...> class F, unsigned K>
+  static runtime_function
+  faithful(std::size_t memo_slots = 1 << 16) {
+    return make<detail::tree<F, K>>(K, memo_slots);
+  }
+
+  unsigned
+  operator () (std::initializer_list<unsigned> xs) {
+    return (*this)(xs.begin(), xs.size());
+  }
+
+  unsigned
+  operator () (unsigned const* xs, std::size_t count) {
+    if (count != arity_)
+      throw std::invalid_argument{"Wrong number of arguments"};
+
+    stack_.assign(xs, xs + count);
+    return eval(root_, 0);
+  }
+
+  unsigned arity() const { return arity_; }
+  std::size_t memo_lookups() const { return lookups_; }
+  std::size_t memo_hits() const { return hits_; }
+
+private:
+  struct memo_entry {
+    std::size_t node = npos;
+    unsigned key[memo_arity];
+    unsigned value;
+  };
+
+  static constexpr std::size_t npos = std::size_t(-1);
+
+  detail::runtime_tree tree_;
+  std::size_t root_ = 0;
+  unsigned arity_;
+
+  // Arguments of the nodes being evaluated. Nodes refer to their arguments by
+  // index, as the vector moves when it grows.
+  std::vector<unsigned> stack_;
+
+  std::vector<memo_entry> memo_;
+  std::size_t lookups_ = 0;
+  std::size_t hits_ = 0;
+
+  template <class Tree>
+  static runtime_function
+  make(unsigned arity, std::size_t memo_slots) {
+    runtime_function f{arity, memo_slots};
+    f.root_ = detail::emit(f.tree_, Tree{});
+    return f;
+  }
+
+  runtime_function(unsigned arity, std::size_t memo_slots)
+    : arity_{arity}
+  {
+    std::size_t slots = memo_slots ? 1 : 0;
+    while (slots && slots < memo_slots)
+      slots *= 2;
+    memo_.resize(slots);
+  }
+
+  bool
+  remembers(std::size_t arity) const {
+    return !memo_.empty() && arity <= memo_arity;
+  }
+
+  memo_entry&
+  slot(std::size_t node, unsigned const* key, std::size_t arity) {
+    std::uint64_t h = (node + 1) * 0x9e3779b97f4a7c15ull;
+    for (std::size_t i = 0; i < arity; ++i)
+      h = (h ^ key[i]) * 0x100000001b3ull;
+    return memo_[(h ^ (h >> 29)) & (memo_.size() - 1)];
+  }
+
+  bool
+  recall(std::size_t node, unsigned const* key, std::size_t arity,
+         unsigned& value) {
+    ++lookups_;
+    memo_entry const& e = slot(node, key, arity);
+    if (e.node != node || !std::equal(key, key + arity, e.key))
+      return false;
+
+    ++hits_;
+    value = e.value;
+    return true;
+  }
+
+  void
+  remember(std::size_t node, unsigned const* key, std::size_t arity,
+           unsigned value) {
+    memo_entry& e = slot(node, key, arity);
+    e.node = node;
+    std::copy(key, key + arity, e.key);
+    e.value = value;
+  }
+
+  // The node's value for the arguments at stack_[xs], stack_[xs + 1], ...
+  unsigned
+  eval(std::size_t n, std::size_t xs) {
+    detail::runtime_node const& node = tree_.nodes[n];
+    switch (node.kind) {
+    case detail::runtime_node::zero:
+      return 0;
+
+    case detail::runtime_node::successor:
+      return stack_[xs] + 1;
+
+    case detail::runtime_node::projection:
+      return stack_[xs + node.value];
+
+    case detail::runtime_node::constant:
+      return node.value;
+
+    case detail::runtime_node::substitution: {
+      std::size_t const ys = stack_.size();
+      for (std::size_t i = 1; i < node.count; ++i) {
+        unsigned const y = eval(tree_.operand(node, i), xs);
+        stack_.push_back(y);
+      }
+
+      unsigned const result = eval(tree_.operand(node, 0), ys);
+      stack_.resize(ys);
+      return result;
+    }
+
+    case detail::runtime_node::recursion:
+      return recurse(n, node, xs);
+
+    case detail::runtime_node::minimisation:
+      return minimise(n, node, xs);
+
+    case detail::runtime_node::native:
+      return detail::native(detail::native_op(node.value), &stack_[xs]);
+    }
+    return 0;
+  }
+
+  unsigned
+  recurse(std::size_t n, detail::runtime_node const& node, std::size_t xs) {
+    unsigned const k = node.value;
+    unsigned const y = stack_[xs];
+    bool const memo = remembers(k + 1);
+
+    // ys = (y, f(y, x_1, ..., x_k), x_1, ..., x_k)
+    std::size_t const ys = stack_.size();
+    stack_.resize(ys + k + 2);
+    std::copy_n(stack_.begin() + xs, k + 1, stack_.begin() + ys + 1);
+
+    // The memo key is the y and x_1, ..., x_k at stack_[ys + 1] onwards.
+    unsigned result;
+    if (memo && recall(n, &stack_[ys + 1], k + 1, result)) {
+      stack_.resize(ys);
+      return result;
+    }
+
+    bool resumed = false;
+    if (memo)
+      for (unsigned z = y / memo_stride * memo_stride; z > 0 && !resumed;
+           z -= memo_stride) {
+        stack_[ys + 1] = z;
+        if (recall(n, &stack_[ys + 1], k + 1, result)) {
+          stack_[ys] = z;
+          stack_[ys + 1] = result;
+          resumed = true;
+        }
+      }
+
+    if (!resumed) {
+      stack_[ys] = 0;
+      stack_[ys + 1] = eval(tree_.operand(node, 0), ys + 2);
+    }
+
+    while (stack_[ys] < y) {
+      unsigned const value = eval(tree_.operand(node, 1), ys);
+      unsigned const z = ++stack_[ys];
+      if (memo && z % memo_stride == 0 && z < y) {
+        stack_[ys + 1] = z;
+        remember(n, &stack_[ys + 1], k + 1, value);
+      }
+      stack_[ys + 1] = value;
+    }
+
+    result = stack_[ys + 1];
+    if (memo) {
+      stack_[ys + 1] = y;
+      remember(n, &stack_[ys + 1], k + 1, result);
+    }
+    stack_.resize(ys);
+    return result;
+  }
+
+  unsigned
+  minimise(std::size_t n, detail::runtime_node const& node, std::size_t xs) {
+    unsigned const k = node.value;
+    bool const memo = remembers(k);
+
+    // ys = (z, x_1, ..., x_k)
+    std::size_t const ys = stack_.size();
+    stack_.resize(ys + k + 1);
+    std::copy_n(stack_.begin() + xs, k, stack_.begin() + ys + 1);
+
+    unsigned result;
+    if (memo && recall(n, &stack_[ys + 1], k, result)) {
+      stack_.resize(ys);
+      return result;
+    }
+
+    while (eval(tree_.operand(node, 0), ys) != 0)
+      ++stack_[ys];
+
+    result = stack_[ys];
+    if (memo)
+      remember(n, &stack_[ys + 1], k, result);
+    stack_.resize(ys);
+    return result;
+  }
+};
+
 //
 // Test:
 //
 
+namespace {
+  // Evaluates F on each of the argument lists (K arguments each) in xs:
+  // faithfully without and with remembering, then lowered. Prints evaluations
+  // per second for each.
+  template <template <unsigned...> class F, unsigned K>
+  void
+  benchmark(char const* name, std::vector<unsigned> const& xs) {
+    runtime_function fs[] = {
+      runtime_function::faithful<F, K>(0),
+      runtime_function::faithful<F, K>(),
+      runtime_function::of<F, K>()
+    };
+    char const* const labels[] = {" faithful,", " remembering (", " lowered"};
+
+    std::cout << name << ':';
+    unsigned checks[3] = {};
+    for (std::size_t i = 0; i < 3; ++i) {
+      auto const start = std::chrono::steady_clock::now();
+      for (std::size_t x = 0; x < xs.size(); x += K)
+        checks[i] = checks[i] * 31 + fs[i](&xs[x], K);
+
+      std::chrono::duration<double> const elapsed =
+        std::chrono::steady_clock::now() - start;
+      std::cout << ' ' << unsigned(xs.size() / K / elapsed.count())
+                << labels[i];
+      if (i == 1)
+        std::cout << fs[i].memo_hits() << " of " << fs[i].memo_lookups()
+                  << " lookups hit),";
+    }
+    bool const agree = checks[0] == checks[1] && checks[1] == checks[2];
+    std::cout << " evaluations/s" << (agree ? "\n" : " MISMATCH\n");
+  }
+
+  // Whether F and lowered F give the same value for each of the argument
+  // lists in xs.
+  template <template <unsigned...> class F, unsigned K>
+  void
+  differential(char const* name, std::vector<unsigned> const& xs) {
+    runtime_function faithful = runtime_function::faithful<F, K>();
+    runtime_function lowered = runtime_function::of<F, K>();
+    std::size_t differences = 0;
+    for (std::size_t x = 0; x < xs.size(); x += K)
+      differences += faithful(&xs[x], K) != lowered(&xs[x], K);
+
+    std::cout << name << ": ";
+    if (differences == 0)
+      std::cout << "same on all " << xs.size() / K << " arguments\n";
+    else
+      std::cout << differences << " of " << xs.size() / K << " differ!\n";
+  }
+
+  template <
+    template <unsigned...> class F, unsigned K, detail::native_op Op
+  >
+  constexpr bool
+  lowers_to() {
+    return std::is_same<
+      detail::lowered_tree<F, K>, detail::native_node<Op>
+    >::value;
+  }
+
+  // Every pair (x, y) with x, y < n, row after row.
+  std::vector<unsigned>
+  pairs(unsigned n) {
+    std::vector<unsigned> xs;
+    for (unsigned x = 0; x < n; ++x)
+      for (unsigned y = 0; y < n; ++y)
+        xs.insert(xs.end(), {x, y});
+    return xs;
+  }
+} // end anonymous namespace
+
 int main() {
   std::cout << "5        = " << constant<5>::fun<>::value << '\n';
   std::cout << "2 + 3    = " << sum<2, 3>::value << '\n';
@@ -330,5 +1150,80 @@ int main() {
   std::cout << "sqrt(1)  = " << sqrt<1>::value << '\n';
   std::cout << "sqrt(25) = " << sqrt<25>::value << '\n';
   // std::cout << "sqrt(6)  = " << sqrt<6>::value << '\n';  // Undefined!
-}
 
+  static_assert(evaluate<mul, 9, 25>::value == mul<9, 25>::value, "");
+  static_assert(evaluate<eq, 5, 5>::value == eq<5, 5>::value, "");
+  static_assert(evaluate<sqrt, 25>::value == sqrt<25>::value, "");
+
+  std::cout << "\nEvaluated with loops:\n";
+  std::cout << "2000 + 1    = " << evaluate<sum, 2000, 1>::value << '\n';
+  std::cout << "1000        = " << evaluate<constant<1000>::fun>::value << '\n';
+  std::cout << "900 -' 1    = " << evaluate<pred, 900>::value << '\n';
+  std::cout << "40 * 50     = " << evaluate<mul, 40, 50>::value << '\n';
+  std::cout << "200 = 200   = " << evaluate<eq, 200, 200>::value << '\n';
+  std::cout << "sqrt(81)    = " << evaluate<sqrt, 81>::value << '\n';
+
+  std::cout << "\nEvaluated at runtime:\n";
+  runtime_function runtime_mul = runtime_function::faithful<mul, 2>();
+  runtime_function runtime_sqrt = runtime_function::faithful<sqrt, 1>();
+  std::cout << "300 * 300   = " << runtime_mul({300, 300}) << '\n';
+  std::cout << "sqrt(1024)  = " << runtime_sqrt({1024}) << '\n';
+
+  std::vector<unsigned> squares;
+  for (unsigned z = 0; z < 40; ++z)
+    squares.push_back(z * z);
+
+  benchmark<sum, 2>("sum", pairs(200));
+  benchmark<mul, 2>("mul", pairs(40));
+  benchmark<lt, 2>("lt", pairs(40));
+  benchmark<eq, 2>("eq", pairs(40));
+  benchmark<sqrt, 1>("sqrt", squares);
+
+  using detail::native_op;
+  static_assert(lowers_to<sum, 2, native_op::sum>(), "");
+  static_assert(lowers_to<pred, 1, native_op::pred>(), "");
+  static_assert(lowers_to<sub1, 2, native_op::sub1>(), "");
+  static_assert(lowers_to<sub, 2, native_op::sub>(), "");
+  static_assert(lowers_to<mul, 2, native_op::mul>(), "");
+  static_assert(lowers_to<sgn, 1, native_op::sgn>(), "");
+  static_assert(lowers_to<cosgn, 1, native_op::cosgn>(), "");
+  static_assert(lowers_to<lt, 2, native_op::lt>(), "");
+  static_assert(lowers_to<gt, 2, native_op::gt>(), "");
+  static_assert(lowers_to<eq, 2, native_op::eq>(), "");
+  static_assert(lowers_to<square, 1, native_op::square>(), "");
+
+  static_assert(evaluate<sub1, 3, 8>::value == sub1<3, 8>::value, "");
+  static_assert(evaluate<sub, 8, 3>::value == sub<8, 3>::value, "");
+  static_assert(evaluate<gt, 8, 12>::value == gt<8, 12>::value, "");
+  static_assert(evaluate<neq, 8, 9>::value == neq<8, 9>::value, "");
+  static_assert(
+    evaluate<square, 60>::value == evaluate_faithfully<square, 60>::value, ""
+  );
+  static_assert(
+    evaluate<sqrt, 49>::value == evaluate_faithfully<sqrt, 49>::value, ""
+  );
+
+  std::cout << "\nLowered:\n";
+  std::cout << "100000 * 3000 = " << evaluate<mul, 100000, 3000>::value
+            << '\n';
+  std::cout << "sqrt(1000000) = " << evaluate<sqrt, 1000000>::value << '\n';
+
+  std::vector<unsigned> xs;
+  for (unsigned x = 0; x < 512; ++x)
+    xs.push_back(x);
+
+  std::cout << "\nLowered against faithful:\n";
+  differential<sum, 2>("sum", pairs(64));
+  differential<pred, 1>("pred", xs);
+  differential<sub1, 2>("sub1", pairs(64));
+  differential<sub, 2>("sub", pairs(64));
+  differential<mul, 2>("mul", pairs(64));
+  differential<sgn, 1>("sgn", xs);
+  differential<cosgn, 1>("cosgn", xs);
+  differential<lt, 2>("lt", pairs(64));
+  differential<gt, 2>("gt", pairs(64));
+  differential<eq, 2>("eq", pairs(64));
+  differential<neq, 2>("neq", pairs(64));
+  differential<square, 1>("square", xs);
+  differential<sqrt, 1>("sqrt", squares);
+}
@@ -0,0 +1,70 @@
+//
+// Looking into the traces written by run_traced in turing-machine.cpp. Given
+// just the trace, this program prints what's in it; given a number of steps
+// too, the configuration the machine was in after that many steps; and given
+// a range of steps, the steps themselves.
+//
+// Compile with
+//   $CXX -Wall -Wextra -std=c++17 -pedantic -pthread trace-tool.cpp -o trace-tool
+// and run it as
+//   ./trace-tool TRACE
+//   ./trace-tool TRACE tape STEP
+//   ./trace-tool TRACE steps FROM TO
+// The last prints steps FROM + 1 to TO, one per line: the number of the step,
+// the index of the instruction executed, the symbol written (? when the cell
+// was left as it was) and the movement. States are printed as their IDs in
+// the program's transition table.
+//
+
+#define TURING_MACHINE_NO_MAIN
+#include "turing-machine.cpp"
+
+#include <cstdlib>
+#include <iomanip>
+
+namespace {
+  void
+  print_configuration(checkpoint const& c) {
+    std::cout << "After " << c.steps << " steps in state " << c.state
+              << ":\n";
+    runtime_tape::restore(c.cells, c.leftmost, c.position).print();
+  }
+
+  int
+  usage() {
+    std::cerr << "Usage: trace-tool TRACE [tape STEP | steps FROM TO]\n";
+    return 2;
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2)
+    return usage();
+
+  try {
+    trace_reader reader{argv[1]};
+    std::string const command = argc > 2 ? argv[2] : "";
+
+    if (argc == 2) {
+      std::cout << "Program fingerprint " << std::hex << std::setw(16)
+                << std::setfill('0') << reader.fingerprint() << std::dec
+                << '\n';
+      std::cout << reader.steps() << " steps in " << reader.blocks()
+                << " blocks, " << reader.keyframes() << " keyframes\n";
+      print_configuration(reader.configuration(reader.steps()));
+    } else if (command == "tape" && argc == 4) {
+      print_configuration(reader.configuration(std::stoul(argv[3])));
+    } else if (command == "steps" && argc == 5) {
+      std::size_t step = std::stoul(argv[3]);
+      for (trace_step const& s :
+             reader.records(step, std::stoul(argv[4])))
+        std::cout << ++step << ' ' << s.instruction << ' ' << s.symbol << ' '
+                  << s.movement << '\n';
+    } else
+      return usage();
+  } catch (std::exception const& e) {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
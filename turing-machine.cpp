@@ -5,14 +5,45 @@
 // I cannot guarantee the availabality of an infinite tape at all times.
 //
 // Compile with
-//   $CXX -Wall -Wextra -std=c++11 -pedantic turing-machine.cpp -o turing-machine
-// I've tested this with $CXX = g++ 4.8.1 and clang++ 3.3.
+//   $CXX -Wall -Wextra -std=c++17 -pedantic -pthread turing-machine.cpp -o turing-machine
+// I've tested this with $CXX = g++ 12.2. (The original C++11 version was
+// tested with g++ 4.8.1 and clang++ 3.3.)
 //
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <typeinfo>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TURING_MACHINE_MMAP
+#endif
 
 // 
 // Tape: Our tape will be made of two stacks and a char. The two stacks will
@@ -26,6 +57,8 @@
 // tape cells simply by moving onto them -- in that case, they will not be 
 // removed when the machine moves back even if the machine does not write
 // anything to these empty cells. Empty cells are shown by the '#' character.
+// The whole printout is put together at compile time into a single array of
+// characters, which is then written out in one go.
 //
 
 // The special empty symbol
@@ -58,49 +91,6 @@ struct pop {
   using type = typename Stack::tail;
 };
 
-// Print stack contents to std::cout delimited by spaces. Does not print a
-// newline.
-template <typename Stack>
-struct print_stack;
-
-template <char Head, typename Tail>
-struct print_stack<stack<Head, Tail>> {
-  static void
-  do_(bool space = false) {
-    if (space) std::cout << ' ';
-    std::cout << Head;
-    print_stack<Tail>::do_(true);
-  }
-};
-
-template <>
-struct print_stack<nil> {
-  static void
-  do_(bool space = false) {
-    if (space) std::cout << ' ';
-  }
-};
-
-// Also prints a stack, but in reverse order.
-template <typename Stack>
-struct print_stack_reverse;
-
-template <char Head, typename Tail>
-struct print_stack_reverse<stack<Head, Tail>> {
-  static void
-  do_() {
-    print_stack_reverse<Tail>::do_();
-    std::cout << Head;
-    std::cout << ' ';
-  }
-};
-
-template <>
-struct print_stack_reverse<nil> {
-  static void
-  do_() { }
-};
-
 template <typename Left, char Head, typename Right>
 struct tape {
   using left = Left;
@@ -127,8 +117,22 @@ struct move_right {
 };
 
 namespace detail {
+  // Turn symbols into a stack, the first on top. Like unstack below, it goes
+  // eight symbols at a time.
   template <char...> struct stackify;
 
+  template <
+    char C0, char C1, char C2, char C3, char C4, char C5, char C6, char C7,
+    char... Cs
+  >
+  struct stackify<C0, C1, C2, C3, C4, C5, C6, C7, Cs...> {
+    using type =
+      stack<C0, stack<C1, stack<C2, stack<C3,
+        stack<C4, stack<C5, stack<C6, stack<C7,
+          typename stackify<Cs...>::type
+        >>>>>>>>;
+  };
+
   template <char C, char... Cs>
   struct stackify<C, Cs...> {
     using type = stack<C, typename stackify<Cs...>::type>;
@@ -138,6 +142,55 @@ namespace detail {
   struct stackify<> {
     using type = nil;
   };
+
+  // Turn a stack into an array of its symbols, top first. Eight symbols are
+  // taken off at a time, so that long tapes don't nest the instantiations too
+  // deep.
+  template <typename Stack, char... Symbols>
+  struct unstack;
+
+  template <
+    char C0, char C1, char C2, char C3, char C4, char C5, char C6, char C7,
+    typename Tail, char... Symbols
+  >
+  struct unstack<
+    stack<C0, stack<C1, stack<C2, stack<C3,
+      stack<C4, stack<C5, stack<C6, stack<C7, Tail>>>>>>>>,
+    Symbols...
+  > : unstack<Tail, Symbols..., C0, C1, C2, C3, C4, C5, C6, C7> { };
+
+  template <char Head, typename Tail, char... Symbols>
+  struct unstack<stack<Head, Tail>, Symbols...>
+    : unstack<Tail, Symbols..., Head> { };
+
+  template <char... Symbols>
+  struct unstack<nil, Symbols...> {
+    static constexpr std::array<char, sizeof...(Symbols)> value{{Symbols...}};
+  };
+
+  // The cells to the left of the head, nearest first, are printed in reverse,
+  // each followed by a space; the cells to the right each preceded by one.
+  template <std::size_t L, std::size_t R>
+  constexpr std::array<char, 2 * (L + R) + 5>
+  format_tape(std::array<char, L> const& left, char head,
+              std::array<char, R> const& right) {
+    std::array<char, 2 * (L + R) + 5> out{};
+    std::size_t n = 0;
+    for (std::size_t i = L; i > 0; --i) {
+      out[n++] = left[i - 1];
+      out[n++] = ' ';
+    }
+    out[n++] = '[';
+    out[n++] = head;
+    out[n++] = ']';
+    for (std::size_t i = 0; i < R; ++i) {
+      out[n++] = ' ';
+      out[n++] = right[i];
+    }
+    out[n++] = ' ';
+    out[n++] = '\n';
+    return out;
+  }
 }
 
 // Make a tape out of a list of symbols. It would be awesome if we could make
@@ -158,14 +211,22 @@ struct make_tape<> {
   using type = tape<nil, '#', nil>;
 };
 
+// The tape as print_tape prints it, newline included.
+template <typename Tape>
+struct tape_string {
+  static constexpr auto value = detail::format_tape(
+    detail::unstack<typename Tape::left>::value,
+    Tape::head,
+    detail::unstack<typename Tape::right>::value
+  );
+};
+
 template <typename Tape>
 struct print_tape {
   static void
   do_() {
-    print_stack_reverse<typename Tape::left>::do_();
-    std::cout << "[" << Tape::head << "]";
-    print_stack<typename Tape::right>::do_(true);
-    std::cout << '\n';
+    std::cout.write(tape_string<Tape>::value.data(),
+                    tape_string<Tape>::value.size());
   }
 };
 
@@ -216,6 +277,12 @@ struct write_tape<Tape, wildcard> {
 // instruction for the same state using a non-wildcard read symbol -- otherwise
 // the non-wildcard instruction for the same state won't even be considered.
 //
+// Actually traversing the list on every step would make each step cost as
+// much as the whole program, though. So the program resolves these rules once,
+// up front, into a table indexed by state and symbol, with a separate wildcard
+// column consulted when the symbol's own cell is empty. Every step is then a
+// single lookup with the same outcome as the traversal.
+//
 
 template <
   typename FromState, // The TM state to match
@@ -250,39 +317,409 @@ struct execute_instruction {
 struct fail {};  
 
 namespace detail {
-  // Find a matching instruction. 
-  // match_helper<CurrentState, CurrentHead, InstructionList>::match will
-  // be either the first matching instruction or fail if no instruction
-  // matches.
-  template <typename, char, typename...>
-  struct match_helper;
+  // Not-found marker for the various indices below.
+  constexpr std::size_t npos = static_cast<std::size_t>(-1);
 
-  template <
-    typename State, char Head, typename First, typename... Rest
-  >
-  struct match_helper<State, Head, First, Rest...> {
-    using match =
-      typename std::conditional<
-        std::is_same<State, typename First::from_state>::value &&
-          (Head == First::head_read || First::head_read == wildcard),
-        First,
-        typename match_helper<State, Head, Rest...>::match
-      >::type;
+  // Constant-time lookups in a pack: a class deriving from indexed<I, T> for
+  // each element lets the compiler deduce T from I (or I from T) in a single
+  // overload resolution instead of instantiating one template per element.
+  template <std::size_t I, typename T>
+  struct indexed { };
+
+  template <typename T>
+  struct identity {
+    using type = T;
   };
 
-  template <typename State, char Head>
-  struct match_helper<State, Head> {
-    using match = fail;
+  template <std::size_t I, typename T>
+  identity<T> type_at(indexed<I, T> const*);
+
+  template <typename T, std::size_t I>
+  constexpr std::size_t
+  index_of(indexed<I, T> const*) { return I; }
+
+  template <typename T>
+  constexpr std::size_t
+  index_of(...) { return npos; }
+
+  // Filler base for pack elements that shouldn't be indexed.
+  template <std::size_t I>
+  struct skip { };
+
+  // Types can't be compared in a constexpr function, but addresses can. Each
+  // type gets its own key and two types are the same iff their keys are.
+  // Addresses can't be ordered, though, so a key comes with the name of its
+  // type as the compiler spells it, which can.
+  struct type_id {
+    char const* key;
+    char const* name;
+  };
+
+  template <typename T>
+  struct type_key {
+    static constexpr char value = 0;
+
+    static constexpr type_id
+    id() { return {&value, __PRETTY_FUNCTION__}; }
+  };
+
+  constexpr int
+  compare_names(char const* a, char const* b) {
+    while (*a != '\0' && *a == *b) {
+      ++a;
+      ++b;
+    }
+    return static_cast<unsigned char>(*a) - static_cast<unsigned char>(*b);
+  }
+
+  // Compact IDs 0, 1, 2, ... for the distinct keys, in the order of their
+  // first appearance.
+  template <std::size_t N>
+  struct numbering {
+    std::array<std::size_t, N> ids{};
+    std::array<bool, N> first{};
+    std::size_t count = 0;
+  };
+
+  // Comparing every key with every other one runs out of constexpr
+  // operations at around a thousand instructions. Sorting the keys by name
+  // brings equal keys next to each other, so that each only needs comparing
+  // with the few around it that have the same name -- usually all of them the
+  // same type, but two types can share a name (local classes, for one), so
+  // it's still the keys that decide.
+  template <std::size_t N>
+  constexpr numbering<N>
+  number_keys(std::array<type_id, N> const& ids) {
+    // All names start with the same name of type_key<T>::id, which needn't
+    // be compared over and over again.
+    std::size_t prefix = 0;
+    if (N > 0)
+      for (; ids[0].name[prefix] != '\0'; ++prefix) {
+        bool same = true;
+        for (std::size_t i = 1; i < N && same; ++i)
+          same = ids[i].name[prefix] == ids[0].name[prefix];
+        if (!same)
+          break;
+      }
+
+    // Indices of the keys, merge sorted by name and then index.
+    std::array<std::size_t, N> order{};
+    std::array<std::size_t, N> merged{};
+    for (std::size_t i = 0; i < N; ++i)
+      order[i] = i;
+
+    for (std::size_t run = 1; run < N; run *= 2) {
+      for (std::size_t low = 0; low < N; low += 2 * run) {
+        std::size_t const middle = low + run < N ? low + run : N;
+        std::size_t const high = low + 2 * run < N ? low + 2 * run : N;
+        std::size_t i = low, j = middle, k = low;
+        while (i < middle && j < high)
+          merged[k++] = compare_names(ids[order[j]].name + prefix,
+                                      ids[order[i]].name + prefix) < 0
+            ? order[j++] : order[i++];
+        while (i < middle)
+          merged[k++] = order[i++];
+        while (j < high)
+          merged[k++] = order[j++];
+      }
+      order = merged;
+    }
+
+    // Where each key appears first. Within a group of the same name, the
+    // first of each key comes first.
+    std::array<std::size_t, N> firsts{};
+    for (std::size_t group = 0; group < N; ) {
+      std::size_t end = group + 1;
+      while (end < N && compare_names(ids[order[group]].name + prefix,
+                                      ids[order[end]].name + prefix) == 0)
+        ++end;
+
+      for (std::size_t k = group; k < end; ++k) {
+        std::size_t j = group;
+        while (ids[order[j]].key != ids[order[k]].key)
+          ++j;
+        firsts[order[k]] = order[j];
+      }
+      group = end;
+    }
+
+    numbering<N> result;
+    for (std::size_t i = 0; i < N; ++i) {
+      result.first[i] = firsts[i] == i;
+      result.ids[i] = result.first[i] ? result.count++ : result.ids[firsts[i]];
+    }
+    return result;
+  }
+
+  // The table has one column for each symbol some instruction reads, in the
+  // order of their codes, and a last one for wildcard instructions. The last
+  // column is also where all other symbols are looked up: no instruction
+  // reads them, so only a wildcard one can match.
+  struct symbol_columns {
+    std::array<std::size_t, 256> of{};  // Column of each symbol
+    std::array<char, 256> symbols{};    // Symbol of each column but the last
+    std::size_t count = 0;              // Columns but the last
+
+    constexpr std::size_t
+    column(char symbol) const { return of[static_cast<unsigned char>(symbol)]; }
+
+    constexpr std::size_t
+    wildcard_column() const { return count; }
+
+    constexpr std::size_t
+    width() const { return count + 1; }
+  };
+
+  template <typename Reads>
+  constexpr symbol_columns
+  columns_for(Reads const& reads) {
+    std::array<bool, 256> read{};
+    for (char symbol : reads)
+      if (symbol != wildcard)
+        read[static_cast<unsigned char>(symbol)] = true;
+
+    symbol_columns result;
+    for (std::size_t c = 0; c < 256; ++c)
+      if (read[c])
+        result.symbols[result.count++] = static_cast<char>(c);
+    for (std::size_t& column : result.of)
+      column = result.count;
+    for (std::size_t i = 0; i < result.count; ++i)
+      result.of[static_cast<unsigned char>(result.symbols[i])] = i;
+    return result;
+  }
+
+  // Fill the (state ID, symbol) -> instruction index table. Walking the
+  // instructions in order and only filling empty cells keeps the first-match
+  // semantics of the linear traversal. An instruction for a state that
+  // already has a wildcard entry could never have been reached, so it's
+  // not entered at all.
+  template <std::size_t States, std::size_t Width, std::size_t N>
+  constexpr std::array<std::size_t, States * Width>
+  build_table(std::array<std::size_t, 2 * N> const& ids,
+              std::array<char, N> const& reads,
+              symbol_columns const& columns) {
+    std::array<std::size_t, States * Width> table{};
+    for (std::size_t& cell : table)
+      cell = npos;
+
+    for (std::size_t i = 0; i < N; ++i) {
+      std::size_t const row = ids[i] * Width;
+      if (table[row + columns.wildcard_column()] != npos)
+        continue;
+
+      std::size_t& cell = table[row + columns.column(reads[i])];
+      if (cell == npos)
+        cell = i;
+    }
+    return table;
+  }
+
+  // The second half of the state numbering belongs to the target states.
+  template <std::size_t N>
+  constexpr std::array<std::size_t, N>
+  target_ids(std::array<std::size_t, 2 * N> const& ids) {
+    std::array<std::size_t, N> result{};
+    for (std::size_t i = 0; i < N; ++i)
+      result[i] = ids[N + i];
+    return result;
+  }
+
+  template <std::size_t States, std::size_t N>
+  constexpr std::array<bool, States>
+  final_states(std::array<std::size_t, 2 * N> const& ids,
+               std::array<bool, 2 * N> const& finals) {
+    std::array<bool, States> result{};
+    for (std::size_t i = 0; i < 2 * N; ++i)
+      result[ids[i]] = finals[i];
+    return result;
+  }
+
+  template <typename Numbering, typename Indices, typename... States>
+  struct state_index;
+
+  template <typename Numbering, std::size_t... Is, typename... States>
+  struct state_index<Numbering, std::index_sequence<Is...>, States...>
+    : std::conditional<
+        Numbering::value.first[Is],
+        indexed<Numbering::value.ids[Is], States>,
+        skip<Is>
+      >::type... { };
+
+  template <typename Indices, typename... Instructions>
+  struct instruction_index;
+
+  template <std::size_t... Is, typename... Instructions>
+  struct instruction_index<std::index_sequence<Is...>, Instructions...>
+    : indexed<Is, Instructions>..., indexed<npos, fail> { };
+
+  // Everything program<> needs to match instructions in constant time. All
+  // states mentioned by the program -- source states first, then target
+  // states -- are numbered and the instructions are put into a dense table
+  // keyed by (state ID, symbol).
+  template <typename... Instructions>
+  struct transition_table {
+    struct states {
+      static constexpr numbering<2 * sizeof...(Instructions)> value =
+        number_keys(
+          std::array<type_id, 2 * sizeof...(Instructions)>{{
+            type_key<typename Instructions::from_state>::id()...,
+            type_key<typename Instructions::to_state>::id()...
+          }}
+        );
+    };
+
+    static constexpr std::size_t state_count = states::value.count;
+
+    using state_index = detail::state_index<
+      states,
+      std::make_index_sequence<2 * sizeof...(Instructions)>,
+      typename Instructions::from_state...,
+      typename Instructions::to_state...
+    >;
+
+    using instruction_index = detail::instruction_index<
+      std::index_sequence_for<Instructions...>, Instructions...
+    >;
+
+    // What each instruction does, for engines that don't walk the types.
+    static constexpr std::array<char, sizeof...(Instructions)>
+    reads{{Instructions::head_read...}};
+
+    static constexpr symbol_columns columns = columns_for(reads);
+    static constexpr std::size_t width = columns.width();
+
+    static constexpr std::array<std::size_t, state_count * width>
+    table = build_table<state_count, width, sizeof...(Instructions)>(
+      states::value.ids, reads, columns
+    );
+
+    static constexpr std::array<std::size_t, sizeof...(Instructions)>
+    targets = target_ids<sizeof...(Instructions)>(states::value.ids);
+
+    static constexpr std::array<char, sizeof...(Instructions)>
+    writes{{Instructions::head_write...}};
+
+    static constexpr std::array<char, sizeof...(Instructions)>
+    moves{{Instructions::movement...}};
+
+    static constexpr std::array<bool, state_count>
+    finals = final_states<state_count, sizeof...(Instructions)>(
+      states::value.ids,
+      std::array<bool, 2 * sizeof...(Instructions)>{{
+        Instructions::from_state::final..., Instructions::to_state::final...
+      }}
+    );
+
+    // The name of the state with the given ID, for printing.
+    static char const*
+    state_name(std::size_t state) {
+      static char const* const names[] = {
+        typeid(typename Instructions::from_state).name()...,
+        typeid(typename Instructions::to_state).name()...
+      };
+
+      for (std::size_t i = 0; i < 2 * sizeof...(Instructions); ++i)
+        if (states::value.ids[i] == state)
+          return names[i];
+      return nullptr;
+    }
+
+    // Index of the instruction to execute in the given state, or npos.
+    static constexpr std::size_t
+    find(std::size_t state, char head) {
+      if (state == npos)
+        return npos;
+
+      std::size_t const row = state * width;
+      std::size_t const specific = table[row + columns.column(head)];
+      return specific != npos
+        ? specific : table[row + columns.wildcard_column()];
+    }
   };
 
 }  // end namespace detail
 
+// What a machine did during a run: how many times each instruction was
+// executed, how many steps were made in each state, how far the head went
+// from the cell it started on and how many times it turned around.
+template <std::size_t Instructions, std::size_t States>
+struct run_profile {
+  std::size_t steps = 0;
+  std::array<std::size_t, Instructions> hits{};
+  std::array<std::size_t, States> state_steps{};
+  std::size_t left_extent = 0;
+  std::size_t right_extent = 0;
+  std::size_t reversals = 0;
+  char last_movement = '0';  // The last movement other than '0'
+
+  // Account for one step made by the given instruction from the given
+  // state, after which the head is Position cells right of where it started.
+  constexpr void
+  record(std::size_t state, std::size_t instruction, char movement,
+         std::ptrdiff_t position) {
+    ++steps;
+    ++hits[instruction];
+    ++state_steps[state];
+
+    if (movement == 'L' || movement == 'R') {
+      if (last_movement != '0' && movement != last_movement)
+        ++reversals;
+      last_movement = movement;
+    }
+
+    if (position < 0 && static_cast<std::size_t>(-position) > left_extent)
+      left_extent = static_cast<std::size_t>(-position);
+    if (position > 0 && static_cast<std::size_t>(position) > right_extent)
+      right_extent = static_cast<std::size_t>(position);
+  }
+};
+
+namespace detail {
+  // Stands in for a run_profile when no profile is asked for, so that a run
+  // doesn't pay for keeping one.
+  struct no_profile {
+    constexpr void
+    record(std::size_t, std::size_t, char, std::ptrdiff_t) {}
+  };
+}  // end namespace detail
+
 // Instruction list.
 template <typename... Instructions>
 struct program {
+  // The transition table and the instructions' effects as constexpr arrays.
+  using table = detail::transition_table<Instructions...>;
+
+  // Every state mentioned by the program has a compact ID in the range
+  // [0, state_count). States not mentioned by it get detail::npos.
+  static constexpr std::size_t state_count = table::state_count;
+
+  using profile = run_profile<sizeof...(Instructions), state_count>;
+
+  template <typename State>
+  static constexpr std::size_t state_id =
+    detail::index_of<State>(
+      static_cast<typename table::state_index const*>(nullptr)
+    );
+
+  template <std::size_t Id>
+  using state_at = typename decltype(
+    detail::type_at<Id>(
+      static_cast<typename table::state_index const*>(nullptr)
+    )
+  )::type;
+
+  // The I-th instruction of the program, or fail for detail::npos.
+  template <std::size_t I>
+  using instruction_at = typename decltype(
+    detail::type_at<I>(
+      static_cast<typename table::instruction_index const*>(nullptr)
+    )
+  )::type;
+
   template <typename State, char Head>
-  using match_instruction = 
-    typename detail::match_helper<State, Head, Instructions...>::match;
+  using match_instruction =
+    instruction_at<table::find(state_id<State>, Head)>;
 };
 
 //
@@ -295,6 +732,11 @@ struct program {
 // instruction puts the machine into a final state. In either case, the last
 // machine thus created is returned as the result.
 //
+// Taking the next step from inside the previous one would nest the
+// instantiations as deep as the machine runs long, and the compiler gives up
+// after about a thousand levels. Instead, the steps are grouped into blocks of
+// exponentially growing size, and each block is split in halves recursively.
+//
 
 template <typename State, typename Tape, typename Program>
 struct machine {
@@ -310,158 +752,4218 @@ struct cont {
     !Machine::state::final && !std::is_same<NextInstruction, fail>::value;
 };
 
-// Run the machine until it halts (if it ever does). run<M>::result will be the
-// final machine configuration.
-template <typename Machine>
-struct run;
-
 namespace detail {
-  template <typename Machine, typename NextInstruction, bool Continue>
-  struct run_helper;
+  template <typename Machine>
+  using next_instruction =
+    typename Machine::program::template match_instruction<
+      typename Machine::state, Machine::tape::head
+    >;
+
+  template <typename Machine>
+  struct halted {
+    static constexpr bool value =
+      !cont<Machine, next_instruction<Machine>>::value;
+  };
 
-  template <typename Machine, typename NextInstruction>
-  struct run_helper<Machine, NextInstruction, true> {
+  // Make a single step. Assumes the machine hasn't halted.
+  template <typename Machine>
+  struct step {
   private:
     using exec = 
       execute_instruction<
-        NextInstruction,
+        next_instruction<Machine>,
         typename Machine::tape
       >;
 
   public:
-    using result = typename run<
-      machine<
-        typename exec::state, typename exec::tape, typename Machine::program
-      >
+    using type = machine<
+      typename exec::state, typename exec::tape, typename Machine::program
+    >;
+  };
+
+  // Make at most Steps steps, stopping early if the machine halts. The steps
+  // are split in two halves run one after the other, so the nesting depth of
+  // the instantiations is only log2(Steps).
+  template <
+    typename Machine, std::size_t Steps, bool Halted = halted<Machine>::value
+  >
+  struct run_steps {
+  private:
+    using first = typename run_steps<Machine, Steps / 2>::result;
+
+  public:
+    using result = typename run_steps<first, Steps - Steps / 2>::result;
+  };
+
+  template <typename Machine, std::size_t Steps>
+  struct run_steps<Machine, Steps, true> {
+    using result = Machine;
+  };
+
+  template <typename Machine>
+  struct run_steps<Machine, 1, false> {
+    using result = typename step<Machine>::type;
+  };
+
+  template <typename Machine>
+  struct run_steps<Machine, 0, false> {
+    using result = Machine;
+  };
+
+  // Run the machine in chunks of 1, 2, 4, ... steps until it halts. A machine
+  // making S steps nests only about 2 * log2(S) levels deep this way.
+  template <
+    typename Machine, std::size_t Chunk, bool Halted = halted<Machine>::value
+  >
+  struct run_chunks {
+    using result = typename run_chunks<
+      typename run_steps<Machine, Chunk>::result, Chunk * 2
     >::result;
   };
 
-  template <typename Machine, typename NextInstruction>
-  struct run_helper<Machine, NextInstruction, false> {
+  template <typename Machine, std::size_t Chunk>
+  struct run_chunks<Machine, Chunk, true> {
     using result = Machine;
   };
 }  // end namespace detail
 
+// Run the machine until it halts (if it ever does). run<M>::result will be the
+// final machine configuration and run<M>::profile a run_profile of the run.
+// The machine's types don't keep count of anything, so the profile is taken
+// from the same run on the constexpr engine below, and only if asked for.
+template <typename Machine, std::size_t Capacity>
+struct run_constexpr;
+
 template <typename Machine>
 struct run {
-private:
-  using next =
-    typename Machine::program::template match_instruction<
-      typename Machine::state, Machine::tape::head
-    >;
+  using result = typename detail::run_chunks<Machine, 1>::result;
 
-public:
-  using result = typename detail::run_helper<
-    Machine, next, cont<Machine, next>::value
-  >::result;
+  static constexpr typename Machine::program::profile profile =
+    run_constexpr<Machine, 4096>::profile;
 };
 
-// 
-// Actually using our magnificient creation:
-//
+// Run the machine for at most MaxSteps steps, which keeps a machine that
+// doesn't halt from instantiating templates until the compiler runs out of
+// memory. run_bounded<M, N> is itself a machine -- the configuration the
+// machine halted in, or that it got to when it ran out of fuel -- so it can
+// be printed by print_result like any other.
+template <typename Machine, std::size_t MaxSteps>
+struct run_bounded {
+  using result = typename detail::run_steps<Machine, MaxSteps>::result;
 
-// Helper type to define states.
-template <bool Final = false>
-struct state {
-  static constexpr bool final = Final;
+  using state = typename result::state;
+  using tape = typename result::tape;
+  using program = typename result::program;
+
+  static constexpr bool halted = detail::halted<result>::value;
+  static constexpr bool accepted = state::final;
+  static constexpr bool out_of_fuel = !halted;
 };
 
-template <typename Machine>
-struct print_result {
-  static void
-  do_() {
-    if (Machine::state::final)
-      std::cout << "Input accepted.\n";
-    else
-      std::cout << "Input not accepted.\n";
+//
+// Constexpr engine: Creating a new tape type for every step is what makes the
+// machine above expensive to compile -- every move allocates fresh stack<>
+// and tape<> types and the compiler keeps all of them around. The same
+// machine can instead be copied into a std::array and run by an ordinary loop
+// in a constexpr function, consulting the very same transition table. Only
+// the final configuration is turned back into types, so the result can be
+// used exactly like that of run<>.
+//
+// The array has a fixed capacity and the input is put in its middle, so the
+// head may wander about Capacity / 2 cells in either direction. A machine
+// that goes any further is a compile error.
+//
 
-    std::cout << "Machine halted in state " 
-              << typeid(typename Machine::state).name()
-              << '\n';
-    std::cout << "Final tape configuration:\n";
-    print_tape<typename Machine::tape>::do_();
-  }
-};
+namespace detail {
+  // A machine configuration with the tape laid out flat. Cells [first, last]
+  // are those the type-level tape would have: the input and every cell the
+  // head has visited. Profile is a run_profile to keep of the run, if any.
+  template <std::size_t Capacity, typename Profile = no_profile>
+  struct flat_machine {
+    std::array<char, Capacity> cells{};
+    std::size_t head = 0;
+    std::size_t first = 0;
+    std::size_t last = 0;
+    std::size_t state = npos;
+    bool final = false;
+    bool overflow = false;
+    std::size_t steps = 0;
+    Profile profile;
+  };
 
-template <typename Machine>
-struct execute {
-  static void
-  do_() {
-    std::cout << "-------------\n";
-    std::cout << "Initial tape:\n";
-    print_tape<typename Machine::tape>::do_();
-    print_result<typename run<Machine>::result>::do_();
-  }
-};
+  template <
+    std::size_t Capacity, typename Profile, std::size_t L, std::size_t R
+  >
+  constexpr flat_machine<Capacity, Profile>
+  flatten(std::size_t state, bool final, std::array<char, L> const& left,
+          char head, std::array<char, R> const& right) {
+    flat_machine<Capacity, Profile> m;
+    for (char& cell : m.cells)
+      cell = empty;
 
-int main() {
-  std::cout << "Input reversal machine:\n";
-  std::cout << "=======================\n";
+    m.head = Capacity / 2;
+    m.state = state;
+    m.final = final;
+    if (L > m.head || R >= Capacity - m.head) {
+      m.overflow = true;
+      return m;
+    }
 
-  struct put_right_marker : state<> { };
-  struct rewind : state<> { };
-  struct go_right_a : state<> { };
-  struct go_right_b : state<> { };
-  struct go_left_a : state<> { };
-  struct go_left_b : state<> { };
-  struct take_left : state<> { };
-  struct take_right : state<> { };
-  struct clear : state<> { };
-  struct clear_a : state<> { };
-  struct clear_b : state<> { };
-  struct clear_last : state<> { };
-  struct end : state<true> { };
+    m.first = m.head - L;
+    m.last = m.head + R;
+    m.cells[m.head] = head;
+    for (std::size_t i = 0; i < L; ++i)
+      m.cells[m.head - 1 - i] = left[i];
+    for (std::size_t i = 0; i < R; ++i)
+      m.cells[m.head + 1 + i] = right[i];
+    return m;
+  }
 
-  using reverse_prog = program<
-    instruction<put_right_marker,   '#', rewind,            '|', 'L'>,
-    instruction<put_right_marker,   '?', put_right_marker,  '?', 'R'>,
+  // The same loop as run<>, only over values, stopping after max_steps steps
+  // at the latest.
+  template <typename Table, std::size_t Capacity, typename Profile>
+  constexpr flat_machine<Capacity, Profile>
+  run_flat(flat_machine<Capacity, Profile> m, std::size_t max_steps = npos) {
+    while (!m.final && !m.overflow && m.steps < max_steps) {
+      std::size_t const i = Table::find(m.state, m.cells[m.head]);
+      if (i == npos)
+        break;
 
-    instruction<rewind,             '#', take_left,         '#', 'R'>,
-    instruction<rewind,             '?', rewind,            '?', 'L'>,
+      std::size_t const from = m.state;
+      if (Table::writes[i] != wildcard)
+        m.cells[m.head] = Table::writes[i];
+      m.state = Table::targets[i];
+      m.final = Table::finals[m.state];
+      ++m.steps;
 
-    instruction<take_left,          'a', go_right_a,        '|', 'R'>,
-    instruction<take_left,          'b', go_right_b,        '|', 'R'>,
-    instruction<take_left,          '|', clear,             '|', 'R'>,
-    
-    instruction<go_right_a,         '|', take_right,        'a', 'L'>,
-    instruction<go_right_b,         '|', take_right,        'b', 'L'>,
-    instruction<go_right_a,         '?', go_right_a,        '?', 'R'>,
-    instruction<go_right_b,         '?', go_right_b,        '?', 'R'>,
+      if (Table::moves[i] == 'L') {
+        if (m.head == 0)
+          m.overflow = true;
+        else if (--m.head < m.first)
+          m.first = m.head;
+      } else if (Table::moves[i] == 'R') {
+        if (m.head + 1 == Capacity)
+          m.overflow = true;
+        else if (++m.head > m.last)
+          m.last = m.head;
+      }
 
-    instruction<take_right,         'a', go_left_a,         '|', 'L'>,
-    instruction<take_right,         'b', go_left_b,         '|', 'L'>,
-    instruction<take_right,         '|', clear,             '|', 'R'>,
+      m.profile.record(
+        from, i, Table::moves[i],
+        static_cast<std::ptrdiff_t>(m.head)
+          - static_cast<std::ptrdiff_t>(Capacity / 2)
+      );
+    }
+    return m;
+  }
 
-    instruction<go_left_a,          '|', take_left,         'a', 'R'>,
-    instruction<go_left_b,          '|', take_left,         'b', 'R'>,
-    instruction<go_left_a,          '?', go_left_a,         '?', 'L'>,
-    instruction<go_left_b,          '?', go_left_b,         '?', 'L'>,
-    
-    instruction<clear,              'a', clear_a,           '|', 'L'>,
-    instruction<clear,              'b', clear_b,           '|', 'L'>,
-    instruction<clear,              '|', clear,             '|', 'R'>,
-    instruction<clear,              '#', clear_last,        '#', 'L'>,
-    instruction<clear_a,            '|', clear,             'a', 'R'>,
-    instruction<clear_b,            '|', clear,             'b', 'R'>,
-    instruction<clear_last,         '|', end,               '#', '0'>
-  >;
+  template <
+    typename Machine, std::size_t Capacity, std::size_t MaxSteps = npos,
+    typename Profile = no_profile
+  >
+  struct run_flat_machine {
+    using table = typename Machine::program::table;
 
-  using reverse_tape1 = make_tape<'a', 'b', 'a', 'a', 'b', 'b', 'a'>::type;
-  using reverse_tape2 = make_tape<'a'>::type;
-  using reverse_tape3 = make_tape<'a', 'b'>::type;
-  using reverse_tape4 = make_tape<>::type;
+    static constexpr flat_machine<Capacity, Profile> value =
+      run_flat<table>(
+        flatten<Capacity, Profile>(
+          Machine::program::template state_id<typename Machine::state>,
+          Machine::state::final,
+          unstack<typename Machine::tape::left>::value,
+          Machine::tape::head,
+          unstack<typename Machine::tape::right>::value
+        ),
+        MaxSteps
+      );
 
-  execute<machine<put_right_marker, reverse_tape1, reverse_prog>>::do_();
-  execute<machine<put_right_marker, reverse_tape2, reverse_prog>>::do_();
-  execute<machine<put_right_marker, reverse_tape3, reverse_prog>>::do_();
-  execute<machine<put_right_marker, reverse_tape4, reverse_prog>>::do_();
+    static_assert(!value.overflow,
+                  "The machine ran off the constexpr engine's tape; "
+                  "raise its Capacity");
+  };
 
-  std::cout << "\n";
-  std::cout << "Acceptor of { a^n b^n c^n : n >= 0 }:\n";
-  std::cout << "=====================================\n";
+  // Back from a flat configuration to a tape<>.
+  template <typename Flat, typename LeftIndices, typename RightIndices>
+  struct unflatten_tape;
 
-  struct check_a  : state<> { };
-  struct check_b  : state<> { };
+  template <typename Flat, std::size_t... Ls, std::size_t... Rs>
+  struct unflatten_tape<
+    Flat, std::index_sequence<Ls...>, std::index_sequence<Rs...>
+  > {
+    using type = tape<
+      typename stackify<Flat::value.cells[Flat::value.head - 1 - Ls]...>::type,
+      Flat::value.cells[Flat::value.head],
+      typename stackify<Flat::value.cells[Flat::value.head + 1 + Rs]...>::type
+    >;
+  };
+
+  // A machine that hasn't made a single step may be in a state the program
+  // doesn't mention, so that has no ID to be looked up by.
+  template <typename Machine, std::size_t State, bool Stepped>
+  struct unflatten_state {
+    using type = typename Machine::state;
+  };
+
+  template <typename Machine, std::size_t State>
+  struct unflatten_state<Machine, State, true> {
+    using type =
+      typename Machine::program::template state_at<State>;
+  };
+}  // end namespace detail
+
+// Run the machine until it halts on the constexpr engine. The result is the
+// same as that of run<Machine>.
+template <typename Machine, std::size_t Capacity = 4096>
+struct run_constexpr {
+private:
+  using flat = detail::run_flat_machine<Machine, Capacity>;
+
+public:
+  using result = machine<
+    typename detail::unflatten_state<
+      Machine, flat::value.state, (flat::value.steps > 0)
+    >::type,
+    typename detail::unflatten_tape<
+      flat,
+      std::make_index_sequence<flat::value.head - flat::value.first>,
+      std::make_index_sequence<flat::value.last - flat::value.head>
+    >::type,
+    typename Machine::program
+  >;
+
+  static constexpr std::size_t steps = flat::value.steps;
+
+  // Only a run that's asked for its profile keeps one, so this is the same
+  // run again with a run_profile.
+  static constexpr typename Machine::program::profile profile =
+    detail::run_flat_machine<
+      Machine, Capacity, detail::npos, typename Machine::program::profile
+    >::value.profile;
+};
+
+// Engine selectors for execute<>.
+struct type_engine {
+  template <typename Machine>
+  using run = ::run<Machine>;
+};
+
+template <std::size_t Capacity = 4096>
+struct constexpr_engine {
+  template <typename Machine>
+  using run = run_constexpr<Machine, Capacity>;
+};
+
+//
+// Optimizer: Since the first matching instruction wins, a program can carry
+// instructions that never fire -- those that come after another instruction
+// for the same state and symbol, or after a wildcard instruction for the same
+// state -- and instructions for states the machine never gets into. Neither
+// kind costs anything to match, thanks to the transition table, but both
+// make the program bigger to compile in every engine.
+//
+// The optimizer drops both kinds and also merges instructions that don't
+// move the head with the steps after them: when it's known what symbol such
+// an instruction leaves under the head, it's also known which instruction
+// the next step will execute, and the two can be done as one. The optimized
+// machine ends up in the same configuration, only in fewer steps. The order
+// of the remaining instructions is kept; the table makes it irrelevant to
+// how fast they are matched.
+//
+
+namespace detail {
+  enum class fate : char { kept, merged, shadowed, unreachable };
+
+  template <std::size_t N>
+  struct optimization {
+    std::array<fate, N> fates{};
+    std::array<std::size_t, N> targets{};
+    std::array<char, N> writes{};
+    std::array<char, N> moves{};
+    std::array<std::size_t, N> kept{};  // Indices of the remaining ones
+    std::size_t kept_count = 0;
+    std::size_t merged_count = 0;
+  };
+
+  template <typename Table>
+  constexpr optimization<Table::reads.size()>
+  optimize_table(std::size_t start) {
+    constexpr std::size_t n = Table::reads.size();
+    optimization<n> result;
+    for (std::size_t i = 0; i < n; ++i) {
+      result.fates[i] = fate::shadowed;
+      result.targets[i] = Table::targets[i];
+      result.writes[i] = Table::writes[i];
+      result.moves[i] = Table::moves[i];
+    }
+    for (std::size_t i : Table::table)
+      if (i != npos)
+        result.fates[i] = fate::kept;
+
+    // A chain of steps that don't move can be endless, so it's only
+    // followed as far as there are instructions.
+    for (std::size_t i = 0; i < n; ++i) {
+      if (result.fates[i] != fate::kept)
+        continue;
+
+      for (std::size_t hop = 0; hop < n && result.moves[i] == '0'; ++hop) {
+        std::size_t const to = result.targets[i];
+        char const symbol =
+          result.writes[i] != wildcard ? result.writes[i] : Table::reads[i];
+        if (symbol == wildcard || Table::finals[to])
+          break;
+
+        std::size_t const next = Table::find(to, symbol);
+        if (next == npos)
+          break;
+
+        result.targets[i] = Table::targets[next];
+        if (Table::writes[next] != wildcard)
+          result.writes[i] = Table::writes[next];
+        result.moves[i] = Table::moves[next];
+        result.fates[i] = fate::merged;
+      }
+      if (result.fates[i] == fate::merged)
+        ++result.merged_count;
+    }
+
+    std::array<bool, Table::state_count> reached{};
+    if (start != npos)
+      reached[start] = true;
+    for (bool grown = true; grown; ) {
+      grown = false;
+      for (std::size_t i = 0; i < n; ++i)
+        if (result.fates[i] != fate::shadowed
+            && reached[Table::states::value.ids[i]]
+            && !reached[result.targets[i]]) {
+          reached[result.targets[i]] = true;
+          grown = true;
+        }
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+      if (result.fates[i] == fate::shadowed)
+        continue;
+      if (!reached[Table::states::value.ids[i]]) {
+        if (result.fates[i] == fate::merged)
+          --result.merged_count;
+        result.fates[i] = fate::unreachable;
+      } else
+        result.kept[result.kept_count++] = i;
+    }
+    return result;
+  }
+
+  template <typename Program, typename Optimization, typename Indices>
+  struct optimized_program;
+
+  template <typename Program, typename Optimization, std::size_t... Ks>
+  struct optimized_program<
+    Program, Optimization, std::index_sequence<Ks...>
+  > {
+    template <std::size_t I>
+    using rewritten = instruction<
+      typename Program::template instruction_at<I>::from_state,
+      Program::template instruction_at<I>::head_read,
+      typename Program::template state_at<Optimization::value.targets[I]>,
+      Optimization::value.writes[I],
+      Optimization::value.moves[I]
+    >;
+
+    using type = program<rewritten<Optimization::value.kept[Ks]>...>;
+  };
+}  // end namespace detail
+
+// optimize<Program, Start>::type is the program without the instructions
+// that can't fire when the machine is started in Start, and with chains of
+// steps that don't move merged.
+template <typename Program, typename Start>
+struct optimize {
+private:
+  using table = typename Program::table;
+
+  struct optimization {
+    static constexpr detail::optimization<table::reads.size()> value =
+      detail::optimize_table<table>(Program::template state_id<Start>);
+  };
+
+public:
+  using type = typename detail::optimized_program<
+    Program, optimization,
+    std::make_index_sequence<optimization::value.kept_count>
+  >::type;
+
+  static constexpr std::size_t removed =
+    table::reads.size() - optimization::value.kept_count;
+  static constexpr std::size_t merged = optimization::value.merged_count;
+
+  // List what was done to which instruction.
+  static void
+  report(std::ostream& out = std::cout) {
+    out << "Removed " << removed << " and merged " << merged << " of "
+        << table::reads.size() << " instructions\n";
+    for (std::size_t i = 0; i < table::reads.size(); ++i) {
+      detail::fate const fate = optimization::value.fates[i];
+      if (fate == detail::fate::kept)
+        continue;
+
+      out << "  Instruction " << i << " ("
+          << table::state_name(table::states::value.ids[i]) << " reading '"
+          << table::reads[i] << "'): ";
+      if (fate == detail::fate::merged)
+        out << "merged with the steps after it\n";
+      else if (fate == detail::fate::shadowed)
+        out << "shadowed by an earlier instruction\n";
+      else
+        out << "unreachable\n";
+    }
+  }
+};
+
+//
+// Runtime engine: Both engines above need the input to be known at compile
+// time. For input that only comes along at runtime, the program's transition
+// table is interpreted by a plain loop over a tape held in a std::vector.
+//
+// The vector is grown in both directions as the head runs off its ends,
+// doubling its size each time, so that moves stay amortised constant-time.
+// Like the type-level tape, the tape remembers which cells the head has
+// visited, and those -- together with the input -- are the cells printed.
+//
+
+namespace detail {
+  template <typename Stops>
+  bool
+  is_stop(char c) {
+    for (std::size_t i = 0; i < Stops::count; ++i)
+      if (c == Stops::symbols[i])
+        return true;
+    return false;
+  }
+
+#ifdef __SSE2__
+  // Bit mask of the stop symbols among the 16 cells at p.
+  template <typename Stops>
+  int
+  stop_mask(char const* p) {
+    __m128i const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    int mask = 0;
+    for (std::size_t i = 0; i < Stops::count; ++i)
+      mask |= _mm_movemask_epi8(
+        _mm_cmpeq_epi8(block, _mm_set1_epi8(Stops::symbols[i]))
+      );
+    return mask;
+  }
+#endif
+
+  // Index of the first stop symbol in [from, size), or size if none.
+  template <typename Stops>
+  std::size_t
+  find_stop(char const* cells, std::size_t from, std::size_t size) {
+#ifdef __SSE2__
+    for (; size - from >= 16; from += 16)
+      if (int const mask = stop_mask<Stops>(cells + from))
+        return from + __builtin_ctz(mask);
+#endif
+    while (from < size && !is_stop<Stops>(cells[from]))
+      ++from;
+    return from;
+  }
+
+  // Index of the last stop symbol in [0, to], or npos if none.
+  template <typename Stops>
+  std::size_t
+  rfind_stop(char const* cells, std::size_t to) {
+    std::size_t end = to + 1;
+#ifdef __SSE2__
+    for (; end >= 16; end -= 16)
+      if (int const mask = stop_mask<Stops>(cells + end - 16))
+        return end - 16 + (31 - __builtin_clz(mask));
+#endif
+    while (end > 0 && !is_stop<Stops>(cells[end - 1]))
+      --end;
+    return end - 1;
+  }
+}  // end namespace detail
+
+namespace detail {
+  // Runtime tapes can be far too long to be put together into a string
+  // before printing. Instead, the characters are collected in a fixed buffer
+  // that is handed over to the stream whenever it fills up.
+  class buffered_writer {
+  public:
+    explicit
+    buffered_writer(std::ostream& out) : out_(out) { }
+
+    buffered_writer(buffered_writer const&) = delete;
+    buffered_writer& operator = (buffered_writer const&) = delete;
+
+    ~buffered_writer() { flush(); }
+
+    void
+    push_back(char c) {
+      if (size_ == buffer_.size())
+        flush();
+      buffer_[size_++] = c;
+    }
+
+    void
+    flush() {
+      out_.write(buffer_.data(), size_);
+      size_ = 0;
+    }
+
+  private:
+    std::ostream& out_;
+    std::array<char, 1 << 16> buffer_;
+    std::size_t size_ = 0;
+  };
+
+  // Cells [first, last] formatted as print_tape would, with no newline, put
+  // into a std::string or a buffered_writer.
+  template <typename Out>
+  void
+  format_cells(Out& out, char const* cells, std::size_t first,
+               std::size_t head, std::size_t last) {
+    for (std::size_t i = first; i < head; ++i) {
+      out.push_back(cells[i]);
+      out.push_back(' ');
+    }
+    out.push_back('[');
+    out.push_back(cells[head]);
+    out.push_back(']');
+    for (std::size_t i = head + 1; i <= last; ++i) {
+      out.push_back(' ');
+      out.push_back(cells[i]);
+    }
+    out.push_back(' ');
+  }
+
+  inline std::string
+  format_cells(char const* cells, std::size_t first, std::size_t head,
+               std::size_t last) {
+    std::string out;
+    out.reserve(2 * (last - first + 1) + 3);
+    format_cells(out, cells, first, head, last);
+    return out;
+  }
+}  // end namespace detail
+
+class runtime_tape {
+public:
+  // Put the first symbol under the head and the rest to the right of it.
+  explicit
+  runtime_tape(std::string const& input)
+    : cells_(input.begin(), input.end())
+    , last_(input.empty() ? 0 : input.size() - 1)
+  {
+    if (cells_.empty())
+      cells_.push_back(empty);
+  }
+
+  char&
+  head() { return cells_[head_]; }
+
+  char
+  head() const { return cells_[head_]; }
+
+  // How many cells right of the first cell of the input the head is.
+  std::ptrdiff_t
+  position() const {
+    return static_cast<std::ptrdiff_t>(head_)
+         - static_cast<std::ptrdiff_t>(origin_);
+  }
+
+  // Positions of the leftmost and the rightmost cell of the input or
+  // visited, counted the same way.
+  std::ptrdiff_t
+  leftmost() const {
+    return static_cast<std::ptrdiff_t>(first_)
+         - static_cast<std::ptrdiff_t>(origin_);
+  }
+
+  std::ptrdiff_t
+  rightmost() const {
+    return static_cast<std::ptrdiff_t>(last_)
+         - static_cast<std::ptrdiff_t>(origin_);
+  }
+
+  // The symbol at the given position; cells never allocated are empty.
+  char
+  at(std::ptrdiff_t position) const {
+    std::ptrdiff_t const i = position + static_cast<std::ptrdiff_t>(origin_);
+    if (i < 0 || static_cast<std::size_t>(i) >= cells_.size())
+      return empty;
+    return cells_[static_cast<std::size_t>(i)];
+  }
+
+  void
+  move_left() {
+    if (head_ == 0)
+      grow_left();
+    if (--head_ < first_)
+      first_ = head_;
+  }
+
+  void
+  move_right() {
+    if (head_ + 1 == cells_.size())
+      cells_.resize(2 * cells_.size(), empty);
+    if (++head_ > last_)
+      last_ = head_;
+  }
+
+  // Move the head to the right up to the nearest cell holding one of the
+  // Stops::symbols, but no further than the cells allocated so far. Returns
+  // the number of cells moved.
+  template <typename Stops>
+  std::size_t
+  skip_right() {
+    std::size_t const from = head_;
+    head_ = detail::find_stop<Stops>(cells_.data(), head_, cells_.size());
+    if (head_ == cells_.size())
+      --head_;
+    if (head_ > last_)
+      last_ = head_;
+    return head_ - from;
+  }
+
+  // The same to the left.
+  template <typename Stops>
+  std::size_t
+  skip_left() {
+    std::size_t const from = head_;
+    head_ = detail::rfind_stop<Stops>(cells_.data(), head_);
+    if (head_ == detail::npos)
+      head_ = 0;
+    if (head_ < first_)
+      first_ = head_;
+    return from - head_;
+  }
+
+  // The cells from leftmost() to rightmost().
+  std::string
+  visited() const {
+    return std::string(cells_.data() + first_, last_ - first_ + 1);
+  }
+
+  // A tape holding the given cells, the first of them at position Leftmost,
+  // with the head at position Position -- the opposite of visited().
+  static runtime_tape
+  restore(std::string const& cells, std::ptrdiff_t leftmost,
+          std::ptrdiff_t position) {
+    runtime_tape tape{cells};
+    tape.origin_ = static_cast<std::size_t>(-leftmost);
+    tape.head_ = static_cast<std::size_t>(position - leftmost);
+    return tape;
+  }
+
+  // The tape in the same format as print_tape prints it, without the
+  // newline.
+  std::string
+  str() const {
+    return detail::format_cells(cells_.data(), first_, head_, last_);
+  }
+
+  void
+  print(std::ostream& out = std::cout) const {
+    detail::buffered_writer writer{out};
+    detail::format_cells(writer, cells_.data(), first_, head_, last_);
+    writer.push_back('\n');
+  }
+
+private:
+  std::vector<char> cells_;
+  std::size_t head_ = 0;
+  std::size_t first_ = 0;  // Leftmost cell of the input or visited
+  std::size_t last_ = 0;   // Rightmost cell of the input or visited
+  std::size_t origin_ = 0; // First cell of the input
+
+  void
+  grow_left() {
+    std::size_t const extra = cells_.size();
+    cells_.insert(cells_.begin(), extra, empty);
+    head_ += extra;
+    origin_ += extra;
+    first_ += extra;
+    last_ += extra;
+  }
+};
+
+// Final configuration of a machine run by a runtime engine.
+template <typename Tape = runtime_tape>
+struct runtime_result {
+  char const* state_name;
+  bool final;
+  Tape tape;
+  std::size_t steps;
+  double seconds;
+};
+
+// Run the program from the given state on a runtime tape until it halts.
+template <typename State, typename Program>
+struct run_runtime {
+  static runtime_result<>
+  do_(runtime_tape tape) {
+    using table = typename Program::table;
+
+    auto const start = std::chrono::steady_clock::now();
+
+    std::size_t state = Program::template state_id<State>;
+    bool final = State::final;
+    std::size_t steps = 0;
+    while (!final) {
+      std::size_t const i = table::find(state, tape.head());
+      if (i == detail::npos)
+        break;
+
+      if (table::writes[i] != wildcard)
+        tape.head() = table::writes[i];
+      state = table::targets[i];
+      final = table::finals[state];
+      ++steps;
+
+      if (table::moves[i] == 'L')
+        tape.move_left();
+      else if (table::moves[i] == 'R')
+        tape.move_right();
+    }
+
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    char const* name =
+      steps > 0 ? table::state_name(state) : typeid(State).name();
+    return {name, final, std::move(tape), steps, elapsed.count()};
+  }
+};
+
+// 
+// Actually using our magnificient creation:
+//
+
+// Helper type to define states.
+template <bool Final = false>
+struct state {
+  static constexpr bool final = Final;
+};
+
+template <typename Machine>
+struct print_result {
+  static void
+  do_() {
+    if (Machine::state::final)
+      std::cout << "Input accepted.\n";
+    else
+      std::cout << "Input not accepted.\n";
+
+    if (detail::halted<Machine>::value)
+      std::cout << "Machine halted in state ";
+    else
+      std::cout << "Machine ran out of fuel in state ";
+    std::cout << typeid(typename Machine::state).name() << '\n';
+    std::cout << "Final tape configuration:\n";
+    print_tape<typename Machine::tape>::do_();
+  }
+};
+
+template <typename Machine, typename Engine = type_engine>
+struct execute {
+  static void
+  do_() {
+    std::cout << "-------------\n";
+    std::cout << "Initial tape:\n";
+    print_tape<typename Machine::tape>::do_();
+    print_result<
+      typename Engine::template run<Machine>::result
+    >::do_();
+  }
+};
+
+//
+// Multi-tape machines: A single head has to shuttle back and forth to carry
+// symbols from one place on the tape to another, which is why reversing the
+// input takes a number of steps quadratic in its length. A machine with
+// several tapes, each with its own head, can instead keep the symbols it
+// still needs on a tape of their own and get by in linearly many steps.
+//
+// A multi-tape instruction reads one symbol from each tape, and writes and
+// moves each head independently. Wildcards match or keep each symbol
+// separately. The program is still matched first-match in program order,
+// and such machines are run by the very same run<> as single-tape ones,
+// which also counts their steps.
+//
+
+// Symbols read or written by a multi-tape instruction, one for each tape.
+template <char... Symbols>
+struct symbols { };
+
+// Head movements of a multi-tape instruction, one for each tape.
+template <char... Movements>
+struct movements { };
+
+template <
+  typename FromState,   // The TM state to match
+  typename HeadsRead,   // symbols<> to match under the heads
+  typename ToState,     // The TM state to transition to
+  typename HeadsWrite,  // symbols<> to write (or wildcards)
+  typename Movements    // movements<> of the heads
+>
+struct multi_instruction {
+  using from_state = FromState;
+  using heads_read = HeadsRead;
+  using to_state = ToState;
+  using heads_write = HeadsWrite;
+  using head_movements = Movements;
+};
+
+template <typename... Tapes>
+struct tapes {
+  static constexpr std::size_t count = sizeof...(Tapes);
+};
+
+namespace detail {
+  template <typename Symbols>
+  struct symbol_array;
+
+  template <char... Symbols>
+  struct symbol_array<symbols<Symbols...>> {
+    static constexpr std::array<char, sizeof...(Symbols)> value{{Symbols...}};
+  };
+
+  template <typename Tapes>
+  struct heads;
+
+  template <typename... Tapes>
+  struct heads<tapes<Tapes...>> {
+    static constexpr std::array<char, sizeof...(Tapes)> value{{
+      Tapes::head...
+    }};
+  };
+
+  // Write and move on every tape.
+  template <typename Tapes, typename Writes, typename Movements>
+  struct execute_on_tapes;
+
+  template <typename... Tapes, char... Writes, char... Movements>
+  struct execute_on_tapes<
+    tapes<Tapes...>, symbols<Writes...>, movements<Movements...>
+  > {
+    static_assert(sizeof...(Writes) == sizeof...(Tapes)
+                  && sizeof...(Movements) == sizeof...(Tapes),
+                  "The instruction doesn't fit the number of tapes");
+
+    using type = tapes<
+      typename move_tape<
+        Movements, typename write_tape<Tapes, Writes>::type
+      >::type...
+    >;
+  };
+
+  template <std::size_t Tapes, std::size_t N>
+  constexpr std::size_t
+  find_multi(std::array<std::size_t, 2 * N> const& ids,
+             std::array<std::array<char, Tapes>, N> const& reads,
+             std::size_t state, std::array<char, Tapes> const& heads) {
+    for (std::size_t i = 0; i < N; ++i) {
+      if (ids[i] != state)
+        continue;
+
+      bool match = true;
+      for (std::size_t t = 0; t < Tapes; ++t)
+        if (reads[i][t] != wildcard && reads[i][t] != heads[t])
+          match = false;
+      if (match)
+        return i;
+    }
+    return npos;
+  }
+}  // end namespace detail
+
+// Multi-tape instruction list. States are numbered the same way program<>
+// numbers them.
+template <typename First, typename... Rest>
+struct multi_program {
+  static constexpr std::size_t tape_count =
+    detail::symbol_array<typename First::heads_read>::value.size();
+
+  struct states {
+    static constexpr detail::numbering<2 * (1 + sizeof...(Rest))> value =
+      detail::number_keys(
+        std::array<detail::type_id, 2 * (1 + sizeof...(Rest))>{{
+          detail::type_key<typename First::from_state>::id(),
+          detail::type_key<typename Rest::from_state>::id()...,
+          detail::type_key<typename First::to_state>::id(),
+          detail::type_key<typename Rest::to_state>::id()...
+        }}
+      );
+  };
+
+  using state_index = detail::state_index<
+    states,
+    std::make_index_sequence<2 * (1 + sizeof...(Rest))>,
+    typename First::from_state, typename Rest::from_state...,
+    typename First::to_state, typename Rest::to_state...
+  >;
+
+  using instruction_index = detail::instruction_index<
+    std::index_sequence_for<First, Rest...>, First, Rest...
+  >;
+
+  static constexpr std::array<
+    std::array<char, tape_count>, 1 + sizeof...(Rest)
+  > reads{{
+    detail::symbol_array<typename First::heads_read>::value,
+    detail::symbol_array<typename Rest::heads_read>::value...
+  }};
+
+  template <typename State>
+  static constexpr std::size_t state_id =
+    detail::index_of<State>(static_cast<state_index const*>(nullptr));
+
+  template <std::size_t I>
+  using instruction_at = typename decltype(
+    detail::type_at<I>(static_cast<instruction_index const*>(nullptr))
+  )::type;
+
+  template <typename State, typename Tapes>
+  using match_instruction = instruction_at<
+    detail::find_multi<tape_count, 1 + sizeof...(Rest)>(
+      states::value.ids, reads, state_id<State>,
+      detail::heads<Tapes>::value
+    )
+  >;
+};
+
+template <
+  typename State, typename Tapes, typename Program, std::size_t Steps = 0
+>
+struct multi_machine {
+  static_assert(Tapes::count == Program::tape_count,
+                "The program doesn't fit the number of tapes");
+
+  using state = State;
+  using tapes = Tapes;
+  using program = Program;
+  static constexpr std::size_t steps = Steps;
+};
+
+namespace detail {
+  template <typename Machine>
+  using next_multi_instruction =
+    typename Machine::program::template match_instruction<
+      typename Machine::state, typename Machine::tapes
+    >;
+
+  template <
+    typename State, typename Tapes, typename Program, std::size_t Steps
+  >
+  struct halted<multi_machine<State, Tapes, Program, Steps>> {
+    static constexpr bool value = !cont<
+      multi_machine<State, Tapes, Program, Steps>,
+      next_multi_instruction<multi_machine<State, Tapes, Program, Steps>>
+    >::value;
+  };
+
+  template <
+    typename State, typename Tapes, typename Program, std::size_t Steps
+  >
+  struct step<multi_machine<State, Tapes, Program, Steps>> {
+  private:
+    using instruction =
+      next_multi_instruction<multi_machine<State, Tapes, Program, Steps>>;
+
+  public:
+    using type = multi_machine<
+      typename instruction::to_state,
+      typename execute_on_tapes<
+        Tapes,
+        typename instruction::heads_write,
+        typename instruction::head_movements
+      >::type,
+      Program,
+      Steps + 1
+    >;
+  };
+}  // end namespace detail
+
+// Only the type engine runs multi-tape machines, so there's no profile to
+// take from the constexpr one. The steps are counted by the result itself.
+template <
+  typename State, typename Tapes, typename Program, std::size_t Steps
+>
+struct run<multi_machine<State, Tapes, Program, Steps>> {
+  using result = typename detail::run_chunks<
+    multi_machine<State, Tapes, Program, Steps>, 1
+  >::result;
+};
+
+template <typename Tapes>
+struct print_tapes;
+
+template <typename... Tapes>
+struct print_tapes<tapes<Tapes...>> {
+  static void
+  do_() { (print_tape<Tapes>::do_(), ...); }
+};
+
+template <typename Machine>
+struct execute_multi {
+  static void
+  do_() {
+    using result = typename run<Machine>::result;
+
+    std::cout << "-------------\n";
+    std::cout << "Initial tapes:\n";
+    print_tapes<typename Machine::tapes>::do_();
+    if (result::state::final)
+      std::cout << "Input accepted.\n";
+    else
+      std::cout << "Input not accepted.\n";
+
+    std::cout << "Machine halted in state "
+              << typeid(typename result::state).name()
+              << " after " << result::steps << " steps\n";
+    std::cout << "Final tape configurations:\n";
+    print_tapes<typename result::tapes>::do_();
+  }
+};
+
+//
+// Compiled engine: The runtime engine above still looks every step up in the
+// table. But the whole program is known at compile time, so each state can
+// instead be turned into a function of its own, which tries that state's
+// instructions in order with the symbols, writes and moves as constants, and
+// keeps going by itself for as long as the machine stays in that state.
+//
+// States that merely scan the tape for some symbols, such as rewind in the
+// reversal machine, don't step over the cells one by one at all. Instead, the
+// tape is searched for the next symbol the state reacts to, 16 cells at a
+// time where SSE2 is available.
+//
+// Ideally, the state functions would jump straight into one another, but
+// standard C++ has neither computed gotos nor guaranteed tail calls. So each
+// of them returns the ID of the next state instead, and a small loop calls
+// the next function through a table -- that only happens when the state
+// actually changes.
+//
+
+namespace detail {
+  // Indices of the instructions for one state, in program order.
+  template <std::size_t N>
+  struct instruction_list {
+    std::array<std::size_t, N> indices{};
+    std::size_t count = 0;
+  };
+
+  template <std::size_t N>
+  constexpr instruction_list<N>
+  instructions_from(std::array<std::size_t, 2 * N> const& ids,
+                    std::size_t state) {
+    instruction_list<N> result;
+    for (std::size_t i = 0; i < N; ++i)
+      if (ids[i] == state)
+        result.indices[result.count++] = i;
+    return result;
+  }
+
+  template <typename Table, std::size_t State>
+  struct state_instructions {
+    static constexpr std::size_t size = Table::reads.size();
+    static constexpr instruction_list<size> value =
+      instructions_from<size>(Table::states::value.ids, State);
+  };
+
+  // A state is a scan if all it does for symbols without an instruction of
+  // their own is moving on in the same direction. It then skips all such
+  // symbols one after the other, so the whole run of them can be skipped in
+  // one go, looking for the nearest symbol that has its own instruction.
+  template <typename Table, std::size_t State>
+  struct scan_state {
+    static constexpr std::size_t loop =
+      Table::table[State * Table::width + Table::columns.wildcard_column()];
+
+    static constexpr bool value =
+      loop != npos && !Table::finals[State] && Table::targets[loop] == State
+      && Table::writes[loop] == wildcard
+      && (Table::moves[loop] == 'L' || Table::moves[loop] == 'R');
+
+    static constexpr char movement = loop != npos ? Table::moves[loop] : '0';
+
+    struct stops {
+      static constexpr std::size_t count = [] {
+        std::size_t result = 0;
+        for (std::size_t c = 0; c < Table::columns.count; ++c)
+          if (Table::table[State * Table::width + c] != npos)
+            ++result;
+        return result;
+      }();
+
+      static constexpr std::array<char, count> symbols = [] {
+        std::array<char, count> result{};
+        std::size_t n = 0;
+        for (std::size_t c = 0; c < Table::columns.count; ++c)
+          if (Table::table[State * Table::width + c] != npos)
+            result[n++] = Table::columns.symbols[c];
+        return result;
+      }();
+    };
+  };
+
+  template <typename Table, std::size_t State, typename Indices>
+  struct compiled_state;
+
+  template <typename Table, std::size_t State, std::size_t... Ks>
+  struct compiled_state<Table, State, std::index_sequence<Ks...>> {
+    // Execute instruction I if it matches and store the next state.
+    template <std::size_t I>
+    static bool
+    try_(runtime_tape& tape, std::size_t& next) {
+      if (Table::reads[I] != wildcard && tape.head() != Table::reads[I])
+        return false;
+
+      if (Table::writes[I] != wildcard)
+        tape.head() = Table::writes[I];
+      if (Table::moves[I] == 'L')
+        tape.move_left();
+      else if (Table::moves[I] == 'R')
+        tape.move_right();
+
+      next = Table::targets[I];
+      return true;
+    }
+
+    // Make steps until the machine leaves this state and return the next
+    // state, or npos if the machine halts in this one.
+    static std::size_t
+    do_(runtime_tape& tape, std::size_t& steps) {
+      if (Table::finals[State])
+        return npos;
+
+      using scan = scan_state<Table, State>;
+
+      for (;;) {
+        if constexpr (scan::value) {
+          if (scan::movement == 'R')
+            steps += tape.template skip_right<typename scan::stops>();
+          else
+            steps += tape.template skip_left<typename scan::stops>();
+        }
+
+        std::size_t next = npos;
+        if (!(try_<
+                state_instructions<Table, State>::value.indices[Ks]
+              >(tape, next) || ...))
+          return npos;
+
+        ++steps;
+        if (next != State)
+          return next;
+      }
+    }
+  };
+
+  template <typename Table, typename States>
+  struct compiled_program;
+
+  template <typename Table, std::size_t... States>
+  struct compiled_program<Table, std::index_sequence<States...>> {
+    using function = std::size_t (*)(runtime_tape&, std::size_t&);
+
+    static constexpr function states[] = {
+      &compiled_state<
+        Table, States,
+        std::make_index_sequence<
+          state_instructions<Table, States>::value.count
+        >
+      >::do_...
+    };
+  };
+}  // end namespace detail
+
+// Run the program from the given state on a runtime tape until it halts,
+// with every state compiled into a function of its own.
+template <typename State, typename Program>
+struct run_compiled {
+  static runtime_result<>
+  do_(runtime_tape tape) {
+    using table = typename Program::table;
+    using compiled = detail::compiled_program<
+      table, std::make_index_sequence<table::state_count>
+    >;
+
+    auto const start = std::chrono::steady_clock::now();
+
+    std::size_t state = Program::template state_id<State>;
+    std::size_t steps = 0;
+    if (!State::final && state != detail::npos)
+      for (;;) {
+        std::size_t const next = compiled::states[state](tape, steps);
+        if (next == detail::npos)
+          break;
+        state = next;
+      }
+
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    if (steps == 0)
+      return {typeid(State).name(), State::final, std::move(tape), 0,
+              elapsed.count()};
+    return {table::state_name(state), table::finals[state], std::move(tape),
+            steps, elapsed.count()};
+  }
+};
+
+//
+// Run-length encoded engine: Machines spend much of their time sweeping over
+// long runs of the same symbol, doing the same thing to every cell of the
+// run. Such a tape can be stored as a list of (symbol, length) runs, and a
+// state that keeps going in the same direction over a run of the symbol it
+// reads can cross the entire run in one macro step, rewriting it as it goes.
+//
+// The tape is organised exactly like the type-level one: two stacks of runs
+// to the left and right of the head, and the symbol under the head.
+//
+
+class rle_tape {
+public:
+  // Put the first symbol under the head and the rest to the right of it.
+  explicit
+  rle_tape(std::string const& input)
+    : head_(input.empty() ? empty : input[0])
+  {
+    for (std::size_t i = input.size(); i > 1; --i)
+      push(right_, input[i - 1], 1);
+  }
+
+  // A tape holding the given cells, the first of them at position Leftmost,
+  // with the head at position Position, as runtime_tape::restore() makes.
+  static rle_tape
+  restore(std::string const& cells, std::ptrdiff_t leftmost,
+          std::ptrdiff_t position) {
+    std::size_t const head = static_cast<std::size_t>(position - leftmost);
+    rle_tape tape{cells.substr(head)};
+    for (std::size_t i = 0; i < head; ++i)
+      push(tape.left_, cells[i], 1);
+    return tape;
+  }
+
+  char&
+  head() { return head_; }
+
+  char
+  head() const { return head_; }
+
+  void
+  move_left() {
+    push(right_, head_, 1);
+    head_ = pop(left_);
+  }
+
+  void
+  move_right() {
+    push(left_, head_, 1);
+    head_ = pop(right_);
+  }
+
+  // Write Symbol (or nothing, if it's wildcard) to the cell under the head
+  // and to all cells after it holding the same symbol, moving the head past
+  // all of them to the right. Returns the number of cells so crossed.
+  std::size_t
+  sweep_right(char symbol) {
+    return sweep(left_, right_, symbol);
+  }
+
+  // The same to the left.
+  std::size_t
+  sweep_left(char symbol) {
+    return sweep(right_, left_, symbol);
+  }
+
+  // Number of runs the tape is stored as.
+  std::size_t
+  runs() const { return left_.size() + 1 + right_.size(); }
+
+  // The tape in the same format as print_tape prints it, without the
+  // newline.
+  std::string
+  str() const {
+    std::string out;
+    format(out);
+    return out;
+  }
+
+  void
+  print(std::ostream& out = std::cout) const {
+    detail::buffered_writer writer{out};
+    format(writer);
+    writer.push_back('\n');
+  }
+
+private:
+  struct run {
+    char symbol;
+    std::size_t length;
+  };
+
+  // The runs closest to the head are at the backs of the stacks.
+  std::vector<run> left_;
+  char head_;
+  std::vector<run> right_;
+
+  // Put the tape into a std::string or a detail::buffered_writer.
+  template <typename Out>
+  void
+  format(Out& out) const {
+    for (run const& r : left_)
+      for (std::size_t i = 0; i < r.length; ++i) {
+        out.push_back(r.symbol);
+        out.push_back(' ');
+      }
+    out.push_back('[');
+    out.push_back(head_);
+    out.push_back(']');
+    for (auto r = right_.rbegin(); r != right_.rend(); ++r)
+      for (std::size_t i = 0; i < r->length; ++i) {
+        out.push_back(' ');
+        out.push_back(r->symbol);
+      }
+    out.push_back(' ');
+  }
+
+  static void
+  push(std::vector<run>& stack, char symbol, std::size_t length) {
+    if (!stack.empty() && stack.back().symbol == symbol)
+      stack.back().length += length;
+    else
+      stack.push_back({symbol, length});
+  }
+
+  // Like nil, an empty stack is an endless source of empty cells.
+  static char
+  pop(std::vector<run>& stack) {
+    if (stack.empty())
+      return empty;
+
+    char const symbol = stack.back().symbol;
+    if (--stack.back().length == 0)
+      stack.pop_back();
+    return symbol;
+  }
+
+  std::size_t
+  sweep(std::vector<run>& behind, std::vector<run>& ahead, char symbol) {
+    std::size_t length = 1;
+    if (!ahead.empty() && ahead.back().symbol == head_) {
+      length += ahead.back().length;
+      ahead.pop_back();
+    }
+
+    push(behind, symbol == wildcard ? head_ : symbol, length);
+    head_ = pop(ahead);
+    return length;
+  }
+};
+
+// Run the program from the given state on a run-length encoded tape until it
+// halts. An instruction that keeps the machine in the same state and moves
+// the head is applied to the whole run under the head at once.
+template <typename State, typename Program>
+struct run_rle {
+  static runtime_result<rle_tape>
+  do_(rle_tape tape) {
+    using table = typename Program::table;
+
+    auto const start = std::chrono::steady_clock::now();
+
+    std::size_t state = Program::template state_id<State>;
+    bool final = State::final;
+    std::size_t steps = 0;
+    while (!final) {
+      std::size_t const i = table::find(state, tape.head());
+      if (i == detail::npos)
+        break;
+
+      bool const sweeps = table::targets[i] == state;
+      if (sweeps && table::moves[i] == 'L') {
+        steps += tape.sweep_left(table::writes[i]);
+        continue;
+      }
+      if (sweeps && table::moves[i] == 'R') {
+        steps += tape.sweep_right(table::writes[i]);
+        continue;
+      }
+
+      if (table::writes[i] != wildcard)
+        tape.head() = table::writes[i];
+      state = table::targets[i];
+      final = table::finals[state];
+      ++steps;
+
+      if (table::moves[i] == 'L')
+        tape.move_left();
+      else if (table::moves[i] == 'R')
+        tape.move_right();
+    }
+
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    char const* name =
+      steps > 0 ? table::state_name(state) : typeid(State).name();
+    return {name, final, std::move(tape), steps, elapsed.count()};
+  }
+};
+
+// Engine selectors for execute_runtime<>.
+struct interpreter_engine {
+  using tape = runtime_tape;
+
+  template <typename State, typename Program>
+  using run = run_runtime<State, Program>;
+};
+
+struct compiled_engine {
+  using tape = runtime_tape;
+
+  template <typename State, typename Program>
+  using run = run_compiled<State, Program>;
+};
+
+struct rle_engine {
+  using tape = rle_tape;
+
+  template <typename State, typename Program>
+  using run = run_rle<State, Program>;
+};
+
+// Same as print_result, followed by how long the machine took.
+struct print_runtime_result {
+  template <typename Tape>
+  static void
+  do_(runtime_result<Tape> const& result) {
+    if (result.final)
+      std::cout << "Input accepted.\n";
+    else
+      std::cout << "Input not accepted.\n";
+
+    std::cout << "Machine halted in state " << result.state_name << '\n';
+    std::cout << "Final tape configuration:\n";
+    result.tape.print();
+    std::cout << "Steps: " << result.steps;
+    if (result.seconds > 0)
+      std::cout << " (" << result.steps / result.seconds << " steps/s)";
+    std::cout << '\n';
+  }
+};
+
+template <
+  typename State, typename Program, typename Engine = interpreter_engine
+>
+struct execute_runtime {
+  static void
+  do_(std::string const& input) {
+    typename Engine::tape tape{input};
+    std::cout << "-------------\n";
+    std::cout << "Initial tape:\n";
+    tape.print();
+    print_runtime_result::do_(
+      Engine::template run<State, Program>::do_(std::move(tape))
+    );
+  }
+};
+
+// Run the program on the same input on all runtime engines and print how
+// fast each of them was.
+template <typename State, typename Program>
+struct compare_runtime_engines {
+  template <typename Tape>
+  static void
+  print(char const* engine, runtime_result<Tape> const& result,
+        runtime_result<> const& reference) {
+    std::cout << engine << result.seconds << " s ("
+              << result.steps / result.seconds << " steps/s)\n";
+    if (result.steps != reference.steps || result.final != reference.final)
+      std::cout << "The engines disagree!\n";
+  }
+
+  static void
+  do_(std::string const& input) {
+    runtime_result<> const interpreted =
+      run_runtime<State, Program>::do_(runtime_tape{input});
+
+    std::cout << "-------------\n";
+    std::cout << "Input of " << input.size() << " symbols, "
+              << interpreted.steps << " steps:\n";
+    print("Interpreted: ", interpreted, interpreted);
+    print("Compiled:    ",
+          run_compiled<State, Program>::do_(runtime_tape{input}),
+          interpreted);
+    print("RLE:         ",
+          run_rle<State, Program>::do_(rle_tape{input}), interpreted);
+  }
+};
+
+//
+// Warm starts: The compile-time engines give a result for free at runtime but
+// can't go far, while the runtime engines go far but start from scratch. A
+// machine can get the best of both by making its first few steps on the
+// constexpr engine during compilation. The configuration it gets to -- the
+// state, the cells visited and the number of steps -- is kept in the binary
+// as constants, and a runtime engine picks up from there. The end result is
+// just that of running the machine on the runtime engine all the way.
+//
+
+// Machine after its first Steps steps, or fewer if it halts before that,
+// made at compile time on the constexpr engine.
+template <typename Machine, std::size_t Steps, std::size_t Capacity = 4096>
+struct warm_start {
+private:
+  using flat = detail::run_flat_machine<Machine, Capacity, Steps>;
+
+public:
+  using program = typename Machine::program;
+
+  static constexpr std::size_t steps = flat::value.steps;
+
+  using state = typename detail::unflatten_state<
+    Machine, flat::value.state, (steps > 0)
+  >::type;
+
+  // The cells of the input and those visited, from the leftmost one on, and
+  // where the leftmost cell and the head are relative to the first cell of
+  // the input.
+  static constexpr std::array<char, flat::value.last - flat::value.first + 1>
+  cells = [] {
+    std::array<char, flat::value.last - flat::value.first + 1> result{};
+    for (std::size_t i = 0; i < result.size(); ++i)
+      result[i] = flat::value.cells[flat::value.first + i];
+    return result;
+  }();
+
+  static constexpr std::ptrdiff_t leftmost =
+    static_cast<std::ptrdiff_t>(flat::value.first)
+    - static_cast<std::ptrdiff_t>(Capacity / 2);
+
+  static constexpr std::ptrdiff_t position =
+    static_cast<std::ptrdiff_t>(flat::value.head)
+    - static_cast<std::ptrdiff_t>(Capacity / 2);
+
+  // Run the rest of the way on the given runtime engine. The steps of the
+  // result include those made at compile time; its time doesn't.
+  template <typename Engine = interpreter_engine>
+  static runtime_result<typename Engine::tape>
+  resume() {
+    runtime_result<typename Engine::tape> result =
+      Engine::template run<state, program>::do_(
+        Engine::tape::restore(
+          std::string(cells.data(), cells.size()), leftmost, position
+        )
+      );
+    result.steps += steps;
+    return result;
+  }
+};
+
+//
+// Profiling: The interpreter can also keep a run_profile of the run, together
+// with the time spent in each state. The clock is only read when the state
+// changes, so it's the states the machine stays in for long that get timed
+// accurately. Profiles can be written out as JSON or CSV.
+//
+
+template <typename Program>
+struct profiled_result : runtime_result<> {
+  typename Program::profile profile;
+  std::array<double, Program::state_count> state_seconds{};
+};
+
+// Run the program like run_runtime does, keeping a profile of the run.
+template <typename State, typename Program>
+struct run_profiled {
+  static profiled_result<Program>
+  do_(runtime_tape tape) {
+    using table = typename Program::table;
+    using clock = std::chrono::steady_clock;
+
+    profiled_result<Program> result{
+      {typeid(State).name(), State::final, std::move(tape), 0, 0.0}, {}, {}
+    };
+    runtime_tape& t = result.tape;
+
+    auto const start = clock::now();
+    auto entered = start;
+
+    std::size_t state = Program::template state_id<State>;
+    bool final = State::final;
+    while (!final) {
+      std::size_t const i = table::find(state, t.head());
+      if (i == detail::npos)
+        break;
+
+      if (table::writes[i] != wildcard)
+        t.head() = table::writes[i];
+      if (table::moves[i] == 'L')
+        t.move_left();
+      else if (table::moves[i] == 'R')
+        t.move_right();
+      result.profile.record(state, i, table::moves[i], t.position());
+
+      if (table::targets[i] != state) {
+        auto const now = clock::now();
+        result.state_seconds[state] +=
+          std::chrono::duration<double>(now - entered).count();
+        entered = now;
+      }
+
+      state = table::targets[i];
+      final = table::finals[state];
+    }
+
+    auto const end = clock::now();
+    if (state != detail::npos)
+      result.state_seconds[state] +=
+        std::chrono::duration<double>(end - entered).count();
+
+    result.steps = result.profile.steps;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    if (result.steps > 0) {
+      result.state_name = table::state_name(state);
+      result.final = final;
+    }
+    return result;
+  }
+};
+
+namespace detail {
+  inline std::string
+  json_string(std::string const& s) {
+    std::string out = "\"";
+    for (char c : s) {
+      if (c == '"' || c == '\\')
+        out += '\\';
+      out += c;
+    }
+    return out + '"';
+  }
+
+  inline std::string
+  csv_field(std::string const& s) {
+    if (s.find_first_of(",\"") == std::string::npos)
+      return s;
+
+    std::string out = "\"";
+    for (char c : s) {
+      if (c == '"')
+        out += '"';
+      out += c;
+    }
+    return out + '"';
+  }
+}  // end namespace detail
+
+// Write a profile of a run of the program out in a machine-readable form.
+// State seconds are only known for runtime runs and may be left out.
+template <typename Program>
+struct profile_report {
+  using profile = typename Program::profile;
+  using table = typename Program::table;
+
+  static std::string
+  from_name(std::size_t i) {
+    return table::state_name(table::states::value.ids[i]);
+  }
+
+  static std::string
+  to_name(std::size_t i) {
+    return table::state_name(table::targets[i]);
+  }
+
+  static void
+  json(std::ostream& out, profile const& p,
+       double const* state_seconds = nullptr) {
+    using detail::json_string;
+
+    out << "{\"steps\": " << p.steps
+        << ", \"left_extent\": " << p.left_extent
+        << ", \"right_extent\": " << p.right_extent
+        << ", \"reversals\": " << p.reversals
+        << ",\n \"instructions\": [";
+    for (std::size_t i = 0; i < p.hits.size(); ++i)
+      out << (i ? ",\n   " : "\n   ")
+          << "{\"index\": " << i
+          << ", \"from\": " << json_string(from_name(i))
+          << ", \"read\": " << json_string({table::reads[i]})
+          << ", \"to\": " << json_string(to_name(i))
+          << ", \"write\": " << json_string({table::writes[i]})
+          << ", \"move\": " << json_string({table::moves[i]})
+          << ", \"hits\": " << p.hits[i] << '}';
+    out << "],\n \"states\": [";
+    for (std::size_t s = 0; s < p.state_steps.size(); ++s) {
+      out << (s ? ",\n   " : "\n   ")
+          << "{\"id\": " << s
+          << ", \"name\": " << json_string(table::state_name(s))
+          << ", \"steps\": " << p.state_steps[s];
+      if (state_seconds)
+        out << ", \"seconds\": " << state_seconds[s];
+      out << '}';
+    }
+    out << "]}\n";
+  }
+
+  // One row per instruction and per state, and one for each of the totals.
+  static void
+  csv(std::ostream& out, profile const& p,
+      double const* state_seconds = nullptr) {
+    using detail::csv_field;
+
+    out << "kind,index,state,read,to,write,move,count,seconds\n";
+    out << "run,,steps,,,,," << p.steps << ",\n";
+    out << "run,,left_extent,,,,," << p.left_extent << ",\n";
+    out << "run,,right_extent,,,,," << p.right_extent << ",\n";
+    out << "run,,reversals,,,,," << p.reversals << ",\n";
+    for (std::size_t i = 0; i < p.hits.size(); ++i)
+      out << "instruction," << i << ',' << csv_field(from_name(i)) << ','
+          << csv_field({table::reads[i]}) << ',' << csv_field(to_name(i))
+          << ',' << csv_field({table::writes[i]}) << ','
+          << csv_field({table::moves[i]}) << ',' << p.hits[i] << ",\n";
+    for (std::size_t s = 0; s < p.state_steps.size(); ++s) {
+      out << "state," << s << ',' << csv_field(table::state_name(s))
+          << ",,,,," << p.state_steps[s] << ',';
+      if (state_seconds)
+        out << state_seconds[s];
+      out << '\n';
+    }
+  }
+};
+
+//
+// Loading machines from files: Programs can also be read at runtime from a
+// text file with one instruction per line, holding the same five fields as
+// instruction<> separated by whitespace:
+//
+//   put_right_marker  #  rewind  |  L
+//
+// Final states are listed on a line starting with "final", and the state the
+// machine starts in on a line starting with "start" -- it's the first state
+// of the first instruction otherwise. Empty lines and lines starting with
+// "//" are skipped.
+//
+// The input of such a machine can be a file as well, which is then mapped
+// into memory rather than read, so that however big it is, nothing but the
+// cells the head gets to is ever paged in. The mapping is private, so the
+// machine's writes never reach the file.
+//
+
+// A program read from a file, in the same form as a program<>'s table.
+struct loaded_program {
+  std::vector<std::string> names;  // Of the states, by ID
+  std::vector<bool> finals;
+  std::vector<char> reads;
+  std::vector<std::size_t> sources;
+  std::vector<std::size_t> targets;
+  std::vector<char> writes;
+  std::vector<char> moves;
+  detail::symbol_columns columns;
+  std::vector<std::size_t> table;
+  std::size_t start = detail::npos;
+
+  static loaded_program
+  parse(std::istream& in) {
+    loaded_program result;
+    std::vector<std::string> finals;
+    std::string start;
+
+    std::string line;
+    for (std::size_t number = 1; std::getline(in, line); ++number) {
+      std::istringstream fields{line};
+      std::string from, read, to, write, move;
+      if (!(fields >> from) || from.compare(0, 2, "//") == 0)
+        continue;
+
+      if (from == "final") {
+        for (std::string name; fields >> name; )
+          finals.push_back(name);
+        continue;
+      }
+      if (from == "start") {
+        fields >> start;
+        continue;
+      }
+
+      if (!(fields >> read >> to >> write >> move) || read.size() != 1
+          || write.size() != 1 || move.size() != 1
+          || move.find_first_of("LR0") != 0)
+        throw std::runtime_error{
+          "Malformed instruction on line " + std::to_string(number)
+        };
+
+      result.sources.push_back(result.id(from));
+      result.reads.push_back(read[0]);
+      result.targets.push_back(result.id(to));
+      result.writes.push_back(write[0]);
+      result.moves.push_back(move[0]);
+    }
+
+    if (result.reads.empty())
+      throw std::runtime_error{"The program has no instructions"};
+
+    result.finals.resize(result.names.size());
+    for (std::string const& name : finals)
+      result.finals[result.id(name)] = true;
+    result.start = start.empty() ? result.sources[0] : result.id(start);
+
+    // Filled in the same way as detail::build_table does it.
+    detail::symbol_columns const& columns = result.columns =
+      detail::columns_for(result.reads);
+    result.table.assign(result.names.size() * columns.width(), detail::npos);
+    for (std::size_t i = 0; i < result.reads.size(); ++i) {
+      std::size_t const row = result.sources[i] * columns.width();
+      if (result.table[row + columns.wildcard_column()] != detail::npos)
+        continue;
+
+      std::size_t& cell = result.table[row + columns.column(result.reads[i])];
+      if (cell == detail::npos)
+        cell = i;
+    }
+    return result;
+  }
+
+  static loaded_program
+  load(std::string const& path) {
+    std::ifstream in{path};
+    if (!in)
+      throw std::runtime_error{"Can't open " + path};
+    return parse(in);
+  }
+
+  std::size_t
+  find(std::size_t state, char head) const {
+    std::size_t const row = state * columns.width();
+    std::size_t const specific = table[row + columns.column(head)];
+    return specific != detail::npos
+      ? specific : table[row + columns.wildcard_column()];
+  }
+
+  char const*
+  state_name(std::size_t state) const { return names[state].c_str(); }
+
+private:
+  std::size_t
+  id(std::string const& name) {
+    auto const found = std::find(names.begin(), names.end(), name);
+    if (found != names.end())
+      return found - names.begin();
+
+    names.push_back(name);
+    finals.push_back(false);
+    return names.size() - 1;
+  }
+};
+
+// A tape whose input is a file mapped into memory. Cells the head visits to
+// either side of the input are kept in vectors of their own. A newline at the
+// very end of the file isn't part of the input.
+class mapped_tape {
+public:
+  explicit
+  mapped_tape(std::string const& path) {
+#ifdef TURING_MACHINE_MMAP
+    int const fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+      if (fd >= 0)
+        close(fd);
+      throw std::runtime_error{"Can't open " + path};
+    }
+
+    mapped_size_ = static_cast<std::size_t>(info.st_size);
+    if (mapped_size_ > 0) {
+      void* const map = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (map == MAP_FAILED)
+        throw std::runtime_error{"Can't map " + path};
+      input_ = static_cast<char*>(map);
+    } else
+      close(fd);
+#else
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+      throw std::runtime_error{"Can't open " + path};
+    storage_.assign(std::istreambuf_iterator<char>{in}, {});
+    input_ = storage_.data();
+    mapped_size_ = storage_.size();
+#endif
+
+    size_ = mapped_size_;
+    if (size_ > 0 && input_[size_ - 1] == '\n')
+      --size_;
+    if (size_ == 0)
+      after_.push_back(empty);
+    else
+      last_ = static_cast<std::ptrdiff_t>(size_) - 1;
+    cell_ = locate(0);
+  }
+
+  mapped_tape(mapped_tape&& other) noexcept
+    : input_(std::exchange(other.input_, nullptr))
+    , mapped_size_(std::exchange(other.mapped_size_, 0))
+    , size_(other.size_)
+    , before_(std::move(other.before_))
+    , after_(std::move(other.after_))
+#ifndef TURING_MACHINE_MMAP
+    , storage_(std::move(other.storage_))
+#endif
+    , head_(other.head_)
+    , first_(other.first_)
+    , last_(other.last_)
+    , cell_(locate(head_))
+  { }
+
+  mapped_tape&
+  operator = (mapped_tape&&) = delete;
+
+  ~mapped_tape() {
+#ifdef TURING_MACHINE_MMAP
+    if (input_)
+      munmap(input_, mapped_size_);
+#endif
+  }
+
+  char&
+  head() { return *cell_; }
+
+  char
+  head() const { return *cell_; }
+
+  void
+  move_left() {
+    if (--head_ < first_) {
+      first_ = head_;
+      if (head_ < 0)
+        before_.push_back(empty);
+    }
+    cell_ = locate(head_);
+  }
+
+  void
+  move_right() {
+    if (++head_ > last_) {
+      last_ = head_;
+      if (static_cast<std::size_t>(head_) >= size_)
+        after_.push_back(empty);
+    }
+    cell_ = locate(head_);
+  }
+
+  std::string
+  str() const {
+    std::string out;
+    format(out);
+    return out;
+  }
+
+  void
+  print(std::ostream& out = std::cout) const {
+    detail::buffered_writer writer{out};
+    format(writer);
+    writer.push_back('\n');
+  }
+
+private:
+  char* input_ = nullptr;
+  std::size_t mapped_size_ = 0;
+  std::size_t size_ = 0;       // Cells of the input
+  std::vector<char> before_;   // Cells left of the input, nearest first
+  std::vector<char> after_;    // Cells right of the input, in order
+#ifndef TURING_MACHINE_MMAP
+  std::vector<char> storage_;  // The input, where it can't be mapped
+#endif
+  std::ptrdiff_t head_ = 0;    // Relative to the first cell of the input
+  std::ptrdiff_t first_ = 0;
+  std::ptrdiff_t last_ = 0;
+  char* cell_ = nullptr;       // The one under the head
+
+  char*
+  locate(std::ptrdiff_t cell) {
+    if (cell < 0)
+      return &before_[static_cast<std::size_t>(-cell - 1)];
+    if (static_cast<std::size_t>(cell) < size_)
+      return input_ + cell;
+    return &after_[static_cast<std::size_t>(cell) - size_];
+  }
+
+  char
+  at(std::ptrdiff_t cell) const {
+    return const_cast<mapped_tape*>(this)->locate(cell)[0];
+  }
+
+  template <typename Out>
+  void
+  format(Out& out) const {
+    for (std::ptrdiff_t i = first_; i < head_; ++i) {
+      out.push_back(at(i));
+      out.push_back(' ');
+    }
+    out.push_back('[');
+    out.push_back(at(head_));
+    out.push_back(']');
+    for (std::ptrdiff_t i = head_ + 1; i <= last_; ++i) {
+      out.push_back(' ');
+      out.push_back(at(i));
+    }
+    out.push_back(' ');
+  }
+};
+
+// Run a loaded program from its start state on any of the runtime tapes
+// until it halts.
+struct run_loaded {
+  template <typename Tape>
+  static runtime_result<Tape>
+  do_(loaded_program const& program, Tape tape) {
+    auto const start = std::chrono::steady_clock::now();
+
+    std::size_t state = program.start;
+    bool final = program.finals[state];
+    std::size_t steps = 0;
+    while (!final) {
+      std::size_t const i = program.find(state, tape.head());
+      if (i == detail::npos)
+        break;
+
+      if (program.writes[i] != wildcard)
+        tape.head() = program.writes[i];
+      state = program.targets[i];
+      final = program.finals[state];
+      ++steps;
+
+      if (program.moves[i] == 'L')
+        tape.move_left();
+      else if (program.moves[i] == 'R')
+        tape.move_right();
+    }
+
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+    return {program.state_name(state), final, std::move(tape), steps,
+            elapsed.count()};
+  }
+};
+
+//
+// Divergence detection: A machine that never halts keeps a runtime engine
+// busy forever. Two common ways of never halting can be recognised while the
+// machine runs, at a small cost per step.
+//
+// Cycles, where the machine gets back into the very same configuration, are
+// caught by Brent's algorithm: the configuration is saved whenever the number
+// of steps since the last save reaches the next power of two, and every step
+// is compared against the saved one. So that the comparison is cheap, the
+// tape is summarised by a hash updated with every write, and only when the
+// state, the head and the hash all agree is the tape compared cell by cell.
+//
+// Translated cycles, where the machine wanders off into empty tape doing the
+// same thing over and over, each time a few cells further, are caught when
+// the head reaches a cell it has never visited. The window of cells behind
+// the head is then remembered for the state the machine is in. Should it come
+// to a new cell in the same state again, having not gone back beyond the
+// window in the meantime, and should the cells behind the head look just the
+// same as back then, the machine will keep repeating itself forever.
+//
+
+struct divergence_options {
+  bool cycles = true;
+  bool translated_cycles = true;
+  std::size_t window = 64;  // Cells behind the head remembered at new cells
+};
+
+enum class divergence { none, cycle, translated_cycle };
+
+struct checked_result : runtime_result<> {
+  divergence diverges = divergence::none;
+};
+
+namespace detail {
+  // Hash of one cell, for summing up the tape by exclusive or. Empty cells
+  // count for nothing, so that cells the head runs onto don't change it.
+  inline std::uint64_t
+  cell_hash(std::ptrdiff_t position, char symbol) {
+    if (symbol == empty)
+      return 0;
+
+    std::uint64_t x = static_cast<std::uint64_t>(position) << 8
+                    | static_cast<unsigned char>(symbol);
+    x += 0x9E3779B97F4A7C15u;
+    x = (x ^ x >> 30) * 0xBF58476D1CE4E5B9u;
+    x = (x ^ x >> 27) * 0x94D049BB133111EBu;
+    return x ^ x >> 31;
+  }
+
+  class cycle_detector {
+  public:
+    cycle_detector(std::size_t state, runtime_tape const& tape,
+                   std::uint64_t hash) {
+      save(state, tape, hash);
+    }
+
+    // Called after every step with the head's position; true if the machine
+    // is back in the saved configuration.
+    bool
+    step(std::size_t state, runtime_tape const& tape, std::ptrdiff_t head,
+         std::uint64_t hash) {
+      if (state == state_ && hash == hash_ && head == head_
+          && same_tape(tape))
+        return true;
+
+      if (++length_ == power_) {
+        save(state, tape, hash);
+        power_ *= 2;
+        length_ = 0;
+      }
+      return false;
+    }
+
+  private:
+    std::size_t state_ = npos;
+    std::uint64_t hash_ = 0;
+    std::ptrdiff_t head_ = 0;
+    std::ptrdiff_t first_ = 0;  // Position of cells_[0]
+    std::string cells_;
+    std::size_t power_ = 1;
+    std::size_t length_ = 0;
+
+    void
+    save(std::size_t state, runtime_tape const& tape, std::uint64_t hash) {
+      state_ = state;
+      hash_ = hash;
+      head_ = tape.position();
+      first_ = tape.leftmost();
+      cells_.clear();
+      for (std::ptrdiff_t i = first_; i <= tape.rightmost(); ++i)
+        cells_ += tape.at(i);
+    }
+
+    char
+    saved_at(std::ptrdiff_t position) const {
+      std::ptrdiff_t const i = position - first_;
+      if (i < 0 || static_cast<std::size_t>(i) >= cells_.size())
+        return empty;
+      return cells_[static_cast<std::size_t>(i)];
+    }
+
+    bool
+    same_tape(runtime_tape const& tape) const {
+      std::ptrdiff_t const from = std::min(first_, tape.leftmost());
+      std::ptrdiff_t const to = std::max(
+        first_ + static_cast<std::ptrdiff_t>(cells_.size()) - 1,
+        tape.rightmost()
+      );
+      for (std::ptrdiff_t i = from; i <= to; ++i)
+        if (tape.at(i) != saved_at(i))
+          return false;
+      return true;
+    }
+  };
+
+  // Looks for translated cycles in one direction: 1 for the right, -1 for
+  // the left. Positions are multiplied by the direction, so that "ahead" is
+  // always up. Where the head has been since it last got to a new cell is
+  // kept track of by the caller -- in its own local variables, that the
+  // compiler can keep in registers, as this is done on every step.
+  class drift_detector {
+  public:
+    drift_detector(int direction, std::size_t states, std::size_t window)
+      : direction_(direction)
+      , window_(static_cast<std::ptrdiff_t>(window))
+      , records_(states)
+    { }
+
+    // Called when the head gets to a new cell, with the furthest back it has
+    // been since it last did; true if the machine is repeating itself.
+    bool
+    new_cell(std::size_t state, runtime_tape const& tape, std::ptrdiff_t head,
+             std::ptrdiff_t lowest) {
+      for (record& r : records_)
+        r.lowest = std::min(r.lowest, lowest);
+
+      record& last = records_[state];
+      if (last.set && last.lowest >= last.edge - window_) {
+        std::ptrdiff_t const shift = head - last.edge;
+        bool same = true;
+        for (std::ptrdiff_t i = last.lowest; i <= last.edge && same; ++i)
+          same = last.window[static_cast<std::size_t>(
+                   i - (last.edge - window_)
+                 )] == at(tape, i + shift);
+        if (same)
+          return true;
+      }
+
+      last.set = true;
+      last.edge = head;
+      last.lowest = head;
+      last.window.clear();
+      for (std::ptrdiff_t i = head - window_; i <= head; ++i)
+        last.window += at(tape, i);
+      return false;
+    }
+
+  private:
+    struct record {
+      bool set = false;
+      std::ptrdiff_t edge = 0;    // Where the head got to a new cell
+      std::ptrdiff_t lowest = 0;  // Furthest back the head has been since
+      std::string window;         // Cells [edge - window_, edge] back then
+    };
+
+    int direction_;
+    std::ptrdiff_t window_;
+    std::vector<record> records_;  // The last one for each state
+
+    char
+    at(runtime_tape const& tape, std::ptrdiff_t position) const {
+      return tape.at(direction_ * position);
+    }
+  };
+
+  // The loop of run_checked, for any table with the members of a
+  // transition_table, whether a program<>'s or one made at runtime. Makes at
+  // most max_steps steps. Inlined into a big caller, the loop loses the
+  // registers it keeps its locals in.
+  template <typename Table>
+  [[gnu::noinline]] divergence
+  run_checked_loop(Table const& table, std::size_t& state, bool& final,
+                   runtime_tape& tape, std::size_t& steps,
+                   divergence_options const& options,
+                   std::size_t max_steps = npos) {
+    divergence diverges = divergence::none;
+    if (final || state == npos)
+      return diverges;
+
+    // Stepped in locals, which the writes to the tape can't change as far as
+    // the compiler knows.
+    std::size_t s = state;
+    bool f = final;
+    std::size_t n = steps;
+
+    // Positions are those of the tape, which needn't have its head on the
+    // cell it started on; a restored tape doesn't.
+    std::ptrdiff_t position = tape.position();
+    std::uint64_t hash = 0;
+    for (std::ptrdiff_t i = tape.leftmost(); i <= tape.rightmost(); ++i)
+      hash ^= cell_hash(i, tape.at(i));
+
+    cycle_detector cycles{s, tape, hash};
+    drift_detector right{1, table.state_count, options.window};
+    drift_detector left{-1, table.state_count, options.window};
+
+    // The furthest the head has been to either side, and the furthest it
+    // has been back to the left (right) since it last got to a new cell on
+    // the right (left).
+    std::ptrdiff_t right_edge = tape.rightmost();
+    std::ptrdiff_t left_edge = tape.leftmost();
+    std::ptrdiff_t low = position;
+    std::ptrdiff_t high = position;
+
+    while (!f && n < max_steps) {
+      std::size_t const i = table.find(s, tape.head());
+      if (i == npos)
+        break;
+
+      if (table.writes[i] != wildcard) {
+        hash ^= cell_hash(position, tape.head())
+              ^ cell_hash(position, table.writes[i]);
+        tape.head() = table.writes[i];
+      }
+      s = table.targets[i];
+      f = table.finals[s];
+      ++n;
+
+      if (table.moves[i] == 'L') {
+        tape.move_left();
+        --position;
+      } else if (table.moves[i] == 'R') {
+        tape.move_right();
+        ++position;
+      }
+
+      if (f)
+        break;
+      if (options.cycles && cycles.step(s, tape, position, hash)) {
+        diverges = divergence::cycle;
+        break;
+      }
+      if (!options.translated_cycles)
+        continue;
+
+      low = std::min(low, position);
+      high = std::max(high, position);
+      bool drifts = false;
+      if (position > right_edge) {
+        right_edge = position;
+        drifts = right.new_cell(s, tape, position, low);
+        low = position;
+      } else if (position < left_edge) {
+        left_edge = position;
+        drifts = left.new_cell(s, tape, -position, -high);
+        high = position;
+      }
+      if (drifts) {
+        diverges = divergence::translated_cycle;
+        break;
+      }
+    }
+
+    state = s;
+    final = f;
+    steps = n;
+    return diverges;
+  }
+}  // end namespace detail
+
+// Run the program like run_runtime does, but stop as soon as the machine is
+// found never to halt.
+template <typename State, typename Program>
+struct run_checked {
+  static checked_result
+  do_(runtime_tape tape, divergence_options const& options = {}) {
+    using table = typename Program::table;
+
+    auto const start = std::chrono::steady_clock::now();
+
+    std::size_t state = Program::template state_id<State>;
+    bool final = State::final;
+    std::size_t steps = 0;
+    divergence const diverges = detail::run_checked_loop(
+      table{}, state, final, tape, steps, options
+    );
+
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    char const* name =
+      steps > 0 ? table::state_name(state) : typeid(State).name();
+    return {{name, final, std::move(tape), steps, elapsed.count()}, diverges};
+  }
+};
+
+// Same as print_runtime_result, saying whether the machine was found to run
+// forever.
+struct print_checked_result {
+  static void
+  do_(checked_result const& result) {
+    if (result.diverges == divergence::none) {
+      print_runtime_result::do_(result);
+      return;
+    }
+
+    std::cout << "Machine diverges: "
+              << (result.diverges == divergence::cycle
+                    ? "it repeats its configuration"
+                    : "it repeats itself further along the tape")
+              << ", found after " << result.steps << " steps in state "
+              << result.state_name << '\n';
+    std::cout << "Tape configuration:\n";
+    result.tape.print();
+  }
+};
+
+//
+// Checkpoints: A long run on a runtime engine can be saved every so many
+// steps and picked up again later from the last save. A checkpoint file holds
+// everything the run needs to go on -- the state ID, the position of the
+// head, the cells visited so far and the number of steps made -- plus a
+// fingerprint of the program, so that a checkpoint isn't resumed with a
+// program other than the one that wrote it.
+//
+// The file starts with the magic "TMCP", a version byte, a flags byte and
+// six little-endian 64-bit numbers: the fingerprint, the state ID, the steps,
+// the position of the leftmost cell, the position of the head and the number
+// of cells. The cells follow, either as they are, or, with the compressed
+// flag set, as runs of a symbol followed by the length of the run in base 128
+// with the high bit set on all but the last digit. Cells are only compressed
+// when that makes them smaller. A checkpoint holds at most
+// checkpoint::max_cells cells, so that a damaged file can't make reading it
+// run out of memory.
+//
+// The machine only stops for as long as it takes to copy the cells it can
+// have changed since the last checkpoint -- those within as many cells of
+// where the head was then as it has made steps since. The copy is kept in
+// chunks shared with the earlier copies, and putting the chunks together,
+// encoding and writing them is done on a thread of its own. Should the
+// machine get to the next checkpoint before the previous one has been
+// written, the previous one is skipped.
+//
+
+struct checkpoint_options {
+  std::string path;
+  std::size_t interval = std::size_t{1} << 24;  // Steps between checkpoints
+  bool compress = true;
+};
+
+namespace detail {
+  // Numbers in binary files: little-endian 64-bit ones, and ones in base 128
+  // with the high bit set on all but the last digit.
+  inline void
+  put_number(std::string& out, std::uint64_t number) {
+    for (unsigned i = 0; i < 64; i += 8)
+      out += static_cast<char>((number >> i) & 0xff);
+  }
+
+  inline void
+  put_base128(std::string& out, std::uint64_t number) {
+    for (; number >= 0x80; number >>= 7)
+      out += static_cast<char>(0x80 | (number & 0x7f));
+    out += static_cast<char>(number);
+  }
+
+  // Reads the same from a string, throwing the given error when it ends too
+  // early or doesn't hold a number.
+  class byte_reader {
+  public:
+    byte_reader(std::string const& in, char const* error, std::size_t at = 0)
+      : in_(in)
+      , error_(error)
+      , at_(at)
+    { }
+
+    [[noreturn]] void
+    fail() const { throw std::runtime_error{error_}; }
+
+    bool
+    done() const { return at_ == in_.size(); }
+
+    std::size_t
+    left() const { return in_.size() - at_; }
+
+    unsigned char
+    byte() {
+      if (done())
+        fail();
+      return static_cast<unsigned char>(in_[at_++]);
+    }
+
+    std::uint64_t
+    number() {
+      std::uint64_t result = 0;
+      for (unsigned i = 0; i < 64; i += 8)
+        result |= std::uint64_t{byte()} << i;
+      return result;
+    }
+
+    std::uint64_t
+    base128() {
+      std::uint64_t result = 0;
+      unsigned char digit;
+      unsigned shift = 0;
+      do {
+        digit = byte();
+        if (shift > 63)
+          fail();
+        result |= std::uint64_t{digit & 0x7fu} << shift;
+        shift += 7;
+      } while (digit & 0x80);
+      return result;
+    }
+
+    // The rest of the string.
+    std::string
+    rest() {
+      std::string result = in_.substr(at_);
+      at_ = in_.size();
+      return result;
+    }
+
+  private:
+    std::string const& in_;
+    char const* error_;
+    std::size_t at_;
+  };
+}  // end namespace detail
+
+// A configuration of a running machine, as written to a checkpoint file.
+struct checkpoint {
+  std::uint64_t fingerprint = 0;
+  std::size_t state = 0;
+  std::size_t steps = 0;
+  std::ptrdiff_t leftmost = 0;
+  std::ptrdiff_t position = 0;
+  std::string cells;
+
+  static constexpr char magic[4] = {'T', 'M', 'C', 'P'};
+  static constexpr unsigned char version = 1;
+  static constexpr unsigned char compressed = 1;
+  static constexpr std::uint64_t max_cells = std::uint64_t{1} << 30;
+
+  std::string
+  encode(bool compress) const {
+    if (cells.size() > max_cells)
+      throw std::runtime_error{"Too many cells for a checkpoint"};
+
+    std::string runs;
+    if (compress) {
+      for (std::size_t i = 0; i < cells.size(); ) {
+        std::size_t run = 1;
+        while (i + run < cells.size() && cells[i + run] == cells[i])
+          ++run;
+        runs += cells[i];
+        detail::put_base128(runs, run);
+        i += run;
+      }
+      // Tapes with many short runs don't compress.
+      compress = runs.size() < cells.size();
+    }
+
+    std::string out(magic, sizeof(magic));
+    out += static_cast<char>(version);
+    out += static_cast<char>(compress ? compressed : 0);
+    for (std::uint64_t number : {
+           fingerprint, std::uint64_t{state}, std::uint64_t{steps},
+           static_cast<std::uint64_t>(leftmost),
+           static_cast<std::uint64_t>(position),
+           std::uint64_t{cells.size()}
+         })
+      detail::put_number(out, number);
+
+    return out + (compress ? runs : cells);
+  }
+
+  static checkpoint
+  decode(std::string const& in) {
+    detail::byte_reader reader{in, "Not a valid checkpoint", sizeof(magic)};
+    if (in.compare(0, sizeof(magic), magic, sizeof(magic)) != 0)
+      reader.fail();
+    if (reader.byte() != version)
+      throw std::runtime_error{"Unsupported checkpoint version"};
+    bool const compress = reader.byte() & compressed;
+
+    checkpoint result;
+    result.fingerprint = reader.number();
+    result.state = reader.number();
+    result.steps = reader.number();
+    result.leftmost = static_cast<std::ptrdiff_t>(reader.number());
+    result.position = static_cast<std::ptrdiff_t>(reader.number());
+    std::uint64_t const size = reader.number();
+    if (size > max_cells)
+      reader.fail();
+
+    if (!compress) {
+      if (reader.left() != size)
+        reader.fail();
+      result.cells = reader.rest();
+    } else {
+      while (!reader.done()) {
+        char const symbol = static_cast<char>(reader.byte());
+        std::uint64_t const run = reader.base128();
+        if (run > size - result.cells.size())
+          reader.fail();
+        result.cells.append(run, symbol);
+      }
+      if (result.cells.size() != size)
+        reader.fail();
+    }
+
+    // The tape always reaches at least from the first cell of the input to
+    // the head.
+    std::ptrdiff_t const cells = static_cast<std::ptrdiff_t>(size);
+    if (result.leftmost > 0 || -result.leftmost >= cells
+        || result.position < result.leftmost
+        || result.position - result.leftmost >= cells)
+      reader.fail();
+    return result;
+  }
+
+  void
+  save(std::string const& path, bool compress) const {
+    // Written next to the file and renamed over it, so that an interrupted
+    // write leaves the previous checkpoint in place.
+    std::string const temporary = path + ".tmp";
+    std::string const bytes = encode(compress);
+    {
+      std::ofstream out{temporary, std::ios::binary | std::ios::trunc};
+      out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+      if (!out.flush())
+        throw std::runtime_error{"Can't write " + temporary};
+    }
+    std::filesystem::rename(temporary, path);
+  }
+
+  static checkpoint
+  load(std::string const& path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+      throw std::runtime_error{"Can't open " + path};
+    std::ostringstream bytes;
+    bytes << in.rdbuf();
+    return decode(bytes.str());
+  }
+};
+
+namespace detail {
+  // FNV-1a over everything the program does: which state goes with each
+  // instruction, what it reads, writes and moves, where it goes and which
+  // states are final. Names of the states don't matter, their order in the
+  // program does.
+  template <typename Table>
+  constexpr std::uint64_t
+  fingerprint() {
+    std::uint64_t hash = 0xcbf29ce484222325;
+    auto const add = [&hash] (std::uint64_t value) {
+      for (unsigned i = 0; i < 64; i += 8) {
+        hash ^= (value >> i) & 0xff;
+        hash *= 0x100000001b3;
+      }
+    };
+
+    add(Table::reads.size());
+    add(Table::state_count);
+    for (std::size_t i = 0; i < Table::reads.size(); ++i) {
+      add(Table::states::value.ids[i]);
+      add(static_cast<unsigned char>(Table::reads[i]));
+      add(Table::targets[i]);
+      add(static_cast<unsigned char>(Table::writes[i]));
+      add(static_cast<unsigned char>(Table::moves[i]));
+    }
+    for (bool final : Table::finals)
+      add(final);
+    return hash;
+  }
+
+  // The cells of a running machine's tape, in chunks that are never changed
+  // once made. A copy shares the chunks, so handing one to another thread
+  // costs a pointer for each chunk, and bringing the chunks up to date only
+  // makes new ones where the tape has changed.
+  class tape_chunks {
+  public:
+    static constexpr std::ptrdiff_t chunk_size = 4096;
+
+    // Bring the chunks up to date with the tape, of whose cells only those
+    // in [from, to] can have changed since the last update. The first update
+    // copies all of them.
+    void
+    update(runtime_tape const& tape, std::ptrdiff_t from, std::ptrdiff_t to) {
+      std::ptrdiff_t const low = index(tape.leftmost());
+      std::ptrdiff_t const high = index(tape.rightmost());
+      if (chunks_.empty()) {
+        first_ = low;
+        from = tape.leftmost();
+        to = tape.rightmost();
+      }
+      if (low < first_) {
+        chunks_.insert(chunks_.begin(), static_cast<std::size_t>(first_ - low),
+                       nullptr);
+        first_ = low;
+      }
+      if (high - first_ >= static_cast<std::ptrdiff_t>(chunks_.size()))
+        chunks_.resize(static_cast<std::size_t>(high - first_ + 1));
+
+      from = std::max(from, tape.leftmost());
+      to = std::min(to, tape.rightmost());
+      for (std::ptrdiff_t i = low; i <= high; ++i) {
+        auto& chunk = chunks_[static_cast<std::size_t>(i - first_)];
+        if (chunk && (i < index(from) || i > index(to)))
+          continue;
+
+        std::string cells(chunk_size, empty);
+        for (std::ptrdiff_t j = 0; j < chunk_size; ++j)
+          cells[static_cast<std::size_t>(j)] = tape.at(i * chunk_size + j);
+        chunk = std::make_shared<std::string const>(std::move(cells));
+      }
+    }
+
+    // Cells [from, to], as runtime_tape::visited() had them at the last
+    // update.
+    std::string
+    cells(std::ptrdiff_t from, std::ptrdiff_t to) const {
+      std::string result;
+      result.reserve(static_cast<std::size_t>(to - from + 1));
+      for (std::ptrdiff_t i = index(from); i <= index(to); ++i) {
+        std::string const& chunk = *chunks_[static_cast<std::size_t>(i - first_)];
+        std::ptrdiff_t const begin = std::max(from - i * chunk_size,
+                                              std::ptrdiff_t{0});
+        std::ptrdiff_t const end = std::min(to - i * chunk_size + 1,
+                                            chunk_size);
+        result.append(chunk, static_cast<std::size_t>(begin),
+                      static_cast<std::size_t>(end - begin));
+      }
+      return result;
+    }
+
+  private:
+    std::ptrdiff_t first_ = 0;  // Index of chunks_[0]
+    std::vector<std::shared_ptr<std::string const>> chunks_;
+
+    // The chunk holding the given position, rounding down.
+    static std::ptrdiff_t
+    index(std::ptrdiff_t position) {
+      return position >= 0 ? position / chunk_size
+                           : -((-position - 1) / chunk_size) - 1;
+    }
+  };
+
+  // A checkpoint with its cells still in chunks, as handed to the writer.
+  struct chunked_checkpoint {
+    checkpoint configuration;  // Without the cells
+    tape_chunks chunks;
+    std::ptrdiff_t rightmost = 0;
+  };
+
+  // Puts together and writes the checkpoints handed to it on a thread of its
+  // own. Only the most recent checkpoint not yet written is kept.
+  class checkpoint_writer {
+  public:
+    checkpoint_writer(std::string path, bool compress)
+      : path_(std::move(path))
+      , compress_(compress)
+      , thread_([this] { work(); })
+    { }
+
+    ~checkpoint_writer() {
+      if (thread_.joinable())
+        stop();
+    }
+
+    void
+    save(chunked_checkpoint&& saved) {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        pending_ = std::move(saved);
+        has_pending_ = true;
+      }
+      wake_.notify_one();
+    }
+
+    // Write the last checkpoint and wait for it; throws if any write failed.
+    void
+    finish() {
+      stop();
+      if (error_)
+        std::rethrow_exception(error_);
+    }
+
+  private:
+    std::string path_;
+    bool compress_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    chunked_checkpoint pending_;
+    bool has_pending_ = false;
+    bool done_ = false;
+    std::exception_ptr error_;
+    std::thread thread_;  // Last, so that it starts after all else is set
+
+    void
+    stop() {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        done_ = true;
+      }
+      wake_.notify_one();
+      thread_.join();
+    }
+
+    void
+    work() {
+      std::unique_lock<std::mutex> lock{mutex_};
+      while (true) {
+        wake_.wait(lock, [this] { return has_pending_ || done_; });
+        if (!has_pending_)
+          return;
+
+        chunked_checkpoint saved = std::move(pending_);
+        has_pending_ = false;
+        lock.unlock();
+        try {
+          saved.configuration.cells = saved.chunks.cells(
+            saved.configuration.leftmost, saved.rightmost
+          );
+          saved.configuration.save(path_, compress_);
+        } catch (...) {
+          if (!error_)
+            error_ = std::current_exception();
+        }
+        lock.lock();
+      }
+    }
+  };
+}  // end namespace detail
+
+// Run the program like run_runtime does, saving a checkpoint to
+// options.path every options.interval steps.
+template <typename State, typename Program>
+struct run_checkpointed {
+  using table = typename Program::table;
+
+  static constexpr std::uint64_t fingerprint = detail::fingerprint<table>();
+
+  static runtime_result<>
+  do_(runtime_tape tape, checkpoint_options const& options) {
+    return run(
+      Program::template state_id<State>, State::final, 0, std::move(tape),
+      options
+    );
+  }
+
+  // Go on from the checkpoint in options.path, saving further checkpoints
+  // to the same file. The steps of the result count from the very start.
+  static runtime_result<>
+  resume(checkpoint_options const& options) {
+    checkpoint saved = checkpoint::load(options.path);
+    if (saved.fingerprint != fingerprint)
+      throw std::runtime_error{
+        options.path + " was saved by a different program"
+      };
+    if (saved.state >= table::state_count)
+      throw std::runtime_error{"Not a valid checkpoint"};
+
+    return run(
+      saved.state, table::finals[saved.state], saved.steps,
+      runtime_tape::restore(saved.cells, saved.leftmost, saved.position),
+      options
+    );
+  }
+
+private:
+  static runtime_result<>
+  run(std::size_t state, bool final, std::size_t steps, runtime_tape tape,
+      checkpoint_options const& options) {
+    auto const start = std::chrono::steady_clock::now();
+
+    detail::checkpoint_writer writer{options.path, options.compress};
+    std::size_t const interval = std::max<std::size_t>(options.interval, 1);
+    std::size_t until_checkpoint = interval - steps % interval;
+
+    // The cells as of the last checkpoint, and where the head was then.
+    detail::tape_chunks chunks;
+    std::ptrdiff_t position = tape.position();
+    std::size_t saved_steps = steps;
+
+    while (!final) {
+      std::size_t const i = table::find(state, tape.head());
+      if (i == detail::npos)
+        break;
+
+      if (table::writes[i] != wildcard)
+        tape.head() = table::writes[i];
+      state = table::targets[i];
+      final = table::finals[state];
+      ++steps;
+
+      if (table::moves[i] == 'L')
+        tape.move_left();
+      else if (table::moves[i] == 'R')
+        tape.move_right();
+
+      if (--until_checkpoint == 0) {
+        until_checkpoint = interval;
+        std::ptrdiff_t const reach =
+          static_cast<std::ptrdiff_t>(steps - saved_steps);
+        chunks.update(tape, position - reach, position + reach);
+        position = tape.position();
+        saved_steps = steps;
+        writer.save({
+          {fingerprint, state, steps, tape.leftmost(), position, {}},
+          chunks, tape.rightmost()
+        });
+      }
+    }
+
+    // Not counting the wait for the last checkpoint to be written.
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+    writer.finish();
+
+    char const* name =
+      steps > 0 ? table::state_name(state) : typeid(State).name();
+    return {name, final, std::move(tape), steps, elapsed.count()};
+  }
+};
+
+//
+// Tracing: How a machine got to where it did can be found out by recording
+// every step of its run -- not as the whole configuration, only as what the
+// step changed: the instruction executed, the symbol it wrote and the
+// movement. As the instruction determines the other two, a step executing
+// the same instruction as the one before it, as whenever the machine sweeps
+// over the tape, only adds to a count, and long sweeps take just a few bytes.
+// The running thread does no more than that, collecting the runs of steps
+// into blocks of trace_options::block runs; the blocks are encoded and
+// written on a thread of their own.
+//
+// Every trace_options::keyframes steps, the block being collected is ended
+// early, however few runs it has, and the whole configuration is written as
+// well, as a checkpoint. The configuration after any step can then be
+// reconstructed by trace_reader by starting from the last keyframe before it
+// and replaying at most that many steps from there.
+//
+// The file starts with the magic "TMTR" and a version byte, followed by the
+// fingerprint of the program, the number of its instructions and the target
+// state of each, as in checkpoints. Chunks follow, each starting with a byte:
+// 'K' for a keyframe, followed by the number of steps made before it, the
+// length of the checkpoint and the checkpoint itself, and 'D' for a block, followed by the number of steps
+// made before the block, the number of steps in it, the length of its data
+// and the data. The data are runs of the instruction index, the symbol, the
+// movement and the number of steps in the run, with both numbers in base
+// 128.
+//
+
+struct trace_options {
+  std::string path;
+  std::size_t block = std::size_t{1} << 14;      // Runs in a block
+  std::size_t keyframes = std::size_t{1} << 22;  // Steps between keyframes
+};
+
+// One step of a trace.
+struct trace_step {
+  std::uint32_t instruction;
+  char symbol;  // Written, or wildcard if the cell was left as it was
+  char movement;
+};
+
+namespace detail {
+  constexpr char trace_magic[4] = {'T', 'M', 'T', 'R'};
+  constexpr unsigned char trace_version = 2;
+
+  struct trace_run {
+    trace_step step;
+    std::size_t count;
+  };
+
+  // Compresses and writes the blocks and keyframes handed to it on a thread
+  // of its own. Should the disk fall behind by more than a few blocks, the
+  // running thread waits for it.
+  class trace_writer {
+  public:
+    trace_writer(std::string const& path, std::string const& header)
+      : out_(path, std::ios::binary | std::ios::trunc)
+      , thread_([this] { work(); })
+    {
+      if (!out_)
+        error_ = std::make_exception_ptr(
+          std::runtime_error{"Can't open " + path}
+        );
+      else
+        out_.write(header.data(), static_cast<std::streamsize>(header.size()));
+    }
+
+    ~trace_writer() {
+      if (thread_.joinable())
+        stop();
+    }
+
+    void
+    block(std::size_t before, std::size_t steps, std::vector<trace_run>&& runs) {
+      push({'D', before, steps, std::move(runs), {}});
+    }
+
+    void
+    keyframe(checkpoint&& configuration) {
+      std::size_t const steps = configuration.steps;
+      push({'K', steps, 0, {}, std::move(configuration)});
+    }
+
+    // Write all that's left and wait for it; throws if any write failed.
+    void
+    finish() {
+      stop();
+      if (!error_ && !out_.flush())
+        error_ = std::make_exception_ptr(
+          std::runtime_error{"Can't write the trace"}
+        );
+      if (error_)
+        std::rethrow_exception(error_);
+    }
+
+  private:
+    struct chunk {
+      char kind;
+      std::size_t before;
+      std::size_t steps;
+      std::vector<trace_run> runs;
+      checkpoint keyframe;
+    };
+
+    static constexpr std::size_t pending_limit = 4;
+
+    std::ofstream out_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<chunk> pending_;
+    bool done_ = false;
+    std::exception_ptr error_;
+    std::thread thread_;  // Last, so that it starts after all else is set
+
+    void
+    push(chunk&& c) {
+      std::unique_lock<std::mutex> lock{mutex_};
+      changed_.wait(lock, [this] { return pending_.size() < pending_limit; });
+      pending_.push_back(std::move(c));
+      changed_.notify_all();
+    }
+
+    void
+    stop() {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        done_ = true;
+      }
+      changed_.notify_all();
+      thread_.join();
+    }
+
+    void
+    work() {
+      std::unique_lock<std::mutex> lock{mutex_};
+      while (true) {
+        changed_.wait(lock, [this] { return !pending_.empty() || done_; });
+        if (pending_.empty())
+          return;
+
+        chunk c = std::move(pending_.front());
+        pending_.pop_front();
+        changed_.notify_all();
+        lock.unlock();
+        std::string const bytes = encode(c);
+        out_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        lock.lock();
+      }
+    }
+
+    static std::string
+    encode(chunk const& c) {
+      std::string out(1, c.kind);
+      if (c.kind == 'K') {
+        std::string const keyframe = c.keyframe.encode(true);
+        put_number(out, c.before);
+        put_number(out, keyframe.size());
+        return out + keyframe;
+      }
+
+      std::string data;
+      for (trace_run const& run : c.runs) {
+        put_base128(data, run.step.instruction);
+        data += run.step.symbol;
+        data += run.step.movement;
+        put_base128(data, run.count);
+      }
+      put_number(out, c.before);
+      put_number(out, c.steps);
+      put_number(out, data.size());
+      return out + data;
+    }
+  };
+}  // end namespace detail
+
+// Run the program like run_runtime does, writing a trace of the run to
+// options.path.
+template <typename State, typename Program>
+struct run_traced {
+  using table = typename Program::table;
+
+  static constexpr std::uint64_t fingerprint = detail::fingerprint<table>();
+
+  static runtime_result<>
+  do_(runtime_tape tape, trace_options const& options) {
+    std::string header(detail::trace_magic, sizeof(detail::trace_magic));
+    header += static_cast<char>(detail::trace_version);
+    detail::put_number(header, fingerprint);
+    detail::put_number(header, table::targets.size());
+    for (std::size_t target : table::targets)
+      detail::put_number(header, target);
+
+    auto const start = std::chrono::steady_clock::now();
+
+    std::size_t state = Program::template state_id<State>;
+    bool final = State::final;
+    std::size_t steps = 0;
+
+    detail::trace_writer writer{options.path, header};
+    writer.keyframe({
+      fingerprint, state, steps, tape.leftmost(), tape.position(),
+      tape.visited()
+    });
+
+    std::size_t const block = std::max<std::size_t>(options.block, 1);
+    std::size_t const keyframes = std::max<std::size_t>(options.keyframes, 1);
+    std::size_t block_start = 0;
+    std::size_t until_keyframe = keyframes;
+    std::vector<detail::trace_run> runs;
+    runs.reserve(block);
+
+    auto const end_block = [&] {
+      writer.block(block_start, steps - block_start, std::move(runs));
+      block_start = steps;
+      runs = {};
+      runs.reserve(block);
+    };
+
+    while (!final) {
+      std::size_t const i = table::find(state, tape.head());
+      if (i == detail::npos)
+        break;
+
+      if (!runs.empty() && runs.back().step.instruction == i)
+        ++runs.back().count;
+      else {
+        if (runs.size() == block)
+          end_block();
+        runs.push_back({
+          {static_cast<std::uint32_t>(i), table::writes[i], table::moves[i]},
+          1
+        });
+      }
+
+      if (table::writes[i] != wildcard)
+        tape.head() = table::writes[i];
+      state = table::targets[i];
+      final = table::finals[state];
+      ++steps;
+
+      if (table::moves[i] == 'L')
+        tape.move_left();
+      else if (table::moves[i] == 'R')
+        tape.move_right();
+
+      // A long sweep is a single run, so blocks can't be relied on to end
+      // in time for a keyframe.
+      if (--until_keyframe == 0) {
+        until_keyframe = keyframes;
+        if (!runs.empty())
+          end_block();
+        writer.keyframe({
+          fingerprint, state, steps, tape.leftmost(), tape.position(),
+          tape.visited()
+        });
+      }
+    }
+    if (!runs.empty())
+      end_block();
+
+    // Not counting the wait for the rest of the trace to be written.
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+    writer.finish();
+
+    char const* name =
+      steps > 0 ? table::state_name(state) : typeid(State).name();
+    return {name, final, std::move(tape), steps, elapsed.count()};
+  }
+};
+
+// Reads a trace written by run_traced. Only the positions of its chunks are
+// read up front; the chunks themselves are read as they're needed.
+class trace_reader {
+public:
+  explicit
+  trace_reader(std::string const& path)
+    : in_(path, std::ios::binary)
+  {
+    if (!in_)
+      throw std::runtime_error{"Can't open " + path};
+    in_.seekg(0, std::ios::end);
+    end_ = in_.tellg();
+    in_.seekg(0);
+
+    std::string const magic = read(sizeof(detail::trace_magic) + 1 + 16);
+    detail::byte_reader header{
+      magic, "Not a valid trace", sizeof(detail::trace_magic)
+    };
+    if (magic.compare(0, sizeof(detail::trace_magic), detail::trace_magic,
+                      sizeof(detail::trace_magic)) != 0)
+      header.fail();
+    if (header.byte() != detail::trace_version)
+      throw std::runtime_error{"Unsupported trace version"};
+    fingerprint_ = header.number();
+
+    std::uint64_t const instructions = header.number();
+    std::string const numbers = read(8 * instructions);
+    detail::byte_reader targets{numbers, "Not a valid trace"};
+    for (std::uint64_t i = 0; i < instructions; ++i)
+      targets_.push_back(targets.number());
+
+    for (char kind; in_.get(kind); ) {
+      std::string const sizes = read(kind == 'D' ? 24 : 16);
+      detail::byte_reader chunk{sizes, "Not a valid trace"};
+      if (kind == 'K') {
+        std::uint64_t const steps = chunk.number();
+        std::uint64_t const size = chunk.number();
+        keyframes_.push_back({steps, size, in_.tellg()});
+        in_.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+      } else if (kind == 'D') {
+        std::uint64_t const before = chunk.number();
+        std::uint64_t const count = chunk.number();
+        std::uint64_t const size = chunk.number();
+        blocks_.push_back({before, count, size, in_.tellg()});
+        in_.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+        steps_ = std::max<std::size_t>(steps_, before + count);
+      } else
+        chunk.fail();
+    }
+    in_.clear();
+
+    if (keyframes_.empty() || keyframes_.front().steps != 0
+        || !std::is_sorted(
+             keyframes_.begin(), keyframes_.end(),
+             [] (keyframe const& a, keyframe const& b) {
+               return a.steps < b.steps;
+             }
+           ))
+      throw std::runtime_error{"Not a valid trace"};
+  }
+
+  std::uint64_t
+  fingerprint() const { return fingerprint_; }
+
+  // Number of steps recorded.
+  std::size_t
+  steps() const { return steps_; }
+
+  std::size_t
+  keyframes() const { return keyframes_.size(); }
+
+  std::size_t
+  blocks() const { return blocks_.size(); }
+
+  // The configuration after the given number of steps.
+  checkpoint
+  configuration(std::size_t step) {
+    if (step > steps_)
+      throw std::runtime_error{
+        "The trace only has " + std::to_string(steps_) + " steps"
+      };
+
+    keyframe const& from = *std::prev(std::upper_bound(
+      keyframes_.begin(), keyframes_.end(), step,
+      [] (std::size_t s, keyframe const& k) { return s < k.steps; }
+    ));
+    checkpoint result = load_keyframe(from);
+    runtime_tape tape =
+      runtime_tape::restore(result.cells, result.leftmost, result.position);
+
+    for_steps(from.steps, step, [&] (trace_step const& s) {
+      if (s.symbol != wildcard)
+        tape.head() = s.symbol;
+      result.state = targets_.at(s.instruction);
+      if (s.movement == 'L')
+        tape.move_left();
+      else if (s.movement == 'R')
+        tape.move_right();
+    });
+
+    result.steps = step;
+    result.leftmost = tape.leftmost();
+    result.position = tape.position();
+    result.cells = tape.visited();
+    return result;
+  }
+
+  // Steps From + 1 to To.
+  std::vector<trace_step>
+  records(std::size_t from, std::size_t to) {
+    std::vector<trace_step> result;
+    for_steps(from, std::min(to, steps_), [&] (trace_step const& s) {
+      result.push_back(s);
+    });
+    return result;
+  }
+
+private:
+  struct keyframe {
+    std::size_t steps;
+    std::uint64_t size;
+    std::streamoff offset;
+  };
+
+  struct block {
+    std::size_t before;
+    std::size_t count;
+    std::uint64_t size;
+    std::streamoff offset;
+  };
+
+  std::ifstream in_;
+  std::uint64_t fingerprint_ = 0;
+  std::vector<std::size_t> targets_;
+  std::vector<keyframe> keyframes_;
+  std::vector<block> blocks_;
+  std::size_t steps_ = 0;
+  std::streamoff end_ = 0;  // Length of the file
+
+  // The next size bytes of the file, which must have that many left.
+  std::string
+  read(std::uint64_t size) {
+    std::streamoff const at = in_.tellg();
+    if (at < 0 || size > static_cast<std::uint64_t>(end_ - at))
+      throw std::runtime_error{"Not a valid trace"};
+
+    std::string result(size, '\0');
+    if (!in_.read(result.data(), static_cast<std::streamsize>(size)))
+      throw std::runtime_error{"Not a valid trace"};
+    return result;
+  }
+
+  checkpoint
+  load_keyframe(keyframe const& k) {
+    in_.seekg(k.offset);
+    checkpoint result = checkpoint::decode(read(k.size));
+    if (result.steps != k.steps)
+      throw std::runtime_error{"Not a valid trace"};
+    return result;
+  }
+
+  // Call f with steps From + 1 to To, reading only the blocks that hold
+  // them.
+  template <typename F>
+  void
+  for_steps(std::size_t from, std::size_t to, F const& f) {
+    for (block const& b : blocks_) {
+      if (b.before + b.count <= from || b.before >= to)
+        continue;
+
+      in_.seekg(b.offset);
+      std::string const data = read(b.size);
+      detail::byte_reader reader{data, "Not a valid trace"};
+      std::size_t step = b.before;
+      while (!reader.done() && step < to) {
+        trace_step s;
+        s.instruction = static_cast<std::uint32_t>(reader.base128());
+        s.symbol = static_cast<char>(reader.byte());
+        s.movement = static_cast<char>(reader.byte());
+        for (std::uint64_t n = reader.base128(); n > 0 && step < to; --n)
+          if (++step > from)
+            f(s);
+      }
+    }
+  }
+};
+
+//
+// Time slicing: The engines above run a machine to completion in one go. Many
+// machines sharing a few cores need to be run a slice at a time instead.
+// resumable_machine keeps a machine's configuration between slices and makes
+// as many steps as it's told, stopping early when the machine halts or, if
+// asked, when it changes state. So that machines of different programs can
+// be kept and stepped side by side, it refers to its program's table through
+// plain pointers rather than by its type.
+//
+// machine_scheduler runs any number of such machines on a pool of threads.
+// The machines take turns from a queue, each turn being a slice of quantum
+// steps times the machine's priority, so that a machine of priority 2 makes
+// twice as many steps as one of priority 1. Machines that halt, use up their
+// step budget or are suspended leave the queue and cost nothing from then on.
+//
+
+namespace detail {
+  // A program<>'s table with its arrays as pointers.
+  struct table_view {
+    symbol_columns const* columns;
+    std::size_t const* table;
+    char const* writes;
+    char const* moves;
+    std::size_t const* targets;
+    bool const* finals;
+    char const* (*state_name)(std::size_t);
+
+    std::size_t
+    find(std::size_t state, char head) const {
+      if (state == npos)
+        return npos;
+
+      std::size_t const row = state * columns->width();
+      std::size_t const specific = table[row + columns->column(head)];
+      return specific != npos
+        ? specific : table[row + columns->wildcard_column()];
+    }
+  };
+
+  template <typename Table>
+  inline constexpr table_view table_view_of{
+    &Table::columns, Table::table.data(), Table::writes.data(), Table::moves.data(),
+    Table::targets.data(), Table::finals.data(), &Table::state_name
+  };
+}  // end namespace detail
+
+// Why resumable_machine::run_for returned.
+enum class slice_end { quota, state_change, halted };
+
+class resumable_machine {
+public:
+  // A machine of the program, in the given state, on the given tape.
+  template <typename State, typename Program>
+  static resumable_machine
+  start(runtime_tape tape) {
+    return resumable_machine{
+      detail::table_view_of<typename Program::table>,
+      Program::template state_id<State>, State::final, typeid(State).name(),
+      std::move(tape)
+    };
+  }
+
+  // Make at most Steps steps, stopping early when the machine halts or, with
+  // until_state_change, when it gets into a state other than the one it was
+  // in. A machine that halts at the very end of the slice returns halted.
+  slice_end
+  run_for(std::size_t steps, bool until_state_change = false) {
+    if (halted_)
+      return slice_end::halted;
+
+    // Stepped in locals, which the writes to the tape can't change as far as
+    // the compiler knows.
+    detail::table_view const t = table_;
+    std::size_t state = state_;
+    bool final = final_;
+    std::size_t made = 0;
+    slice_end end = slice_end::quota;
+    while (made < steps) {
+      std::size_t const i = final ? detail::npos : t.find(state, tape_.head());
+      if (i == detail::npos) {
+        end = slice_end::halted;
+        break;
+      }
+
+      if (t.writes[i] != wildcard)
+        tape_.head() = t.writes[i];
+      std::size_t const from = state;
+      state = t.targets[i];
+      final = t.finals[state];
+      ++made;
+
+      if (t.moves[i] == 'L')
+        tape_.move_left();
+      else if (t.moves[i] == 'R')
+        tape_.move_right();
+
+      if (until_state_change && state != from) {
+        end = slice_end::state_change;
+        break;
+      }
+    }
+
+    if (end != slice_end::halted
+        && (final || t.find(state, tape_.head()) == detail::npos))
+      end = slice_end::halted;
+
+    state_ = state;
+    final_ = final;
+    steps_ += made;
+    halted_ = end == slice_end::halted;
+    return end;
+  }
+
+  bool
+  halted() const { return halted_; }
+
+  bool
+  final() const { return final_; }
+
+  std::size_t
+  steps() const { return steps_; }
+
+  runtime_tape const&
+  tape() const { return tape_; }
+
+  char const*
+  state_name() const {
+    return steps_ > 0 ? table_.state_name(state_) : start_name_;
+  }
+
+private:
+  detail::table_view table_;
+  std::size_t state_;
+  bool final_;
+  bool halted_ = false;
+  std::size_t steps_ = 0;
+  char const* start_name_;  // Of the state it started in
+  runtime_tape tape_;
+
+  resumable_machine(detail::table_view table, std::size_t state, bool final,
+                    char const* start_name, runtime_tape tape)
+    : table_(table)
+    , state_(state)
+    , final_(final)
+    , start_name_(start_name)
+    , tape_(std::move(tape))
+  { }
+};
+
+class machine_scheduler {
+public:
+  explicit
+  machine_scheduler(std::size_t quantum = std::size_t{1} << 12)
+    : quantum_(std::max<std::size_t>(quantum, 1))
+  { }
+
+  // Queue a machine to be run, with the given priority and at most Budget
+  // steps in all, or any number of them if it's 0. Returns its ID. Machines
+  // can be added while the scheduler runs.
+  std::size_t
+  add(resumable_machine machine, unsigned priority = 1,
+      std::size_t budget = 0) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    entries_.push_back({
+      std::move(machine), std::max(priority, 1u), budget
+    });
+    enqueue(entries_.size() - 1);
+    return entries_.size() - 1;
+  }
+
+  // Take the machine out of the queue once its current slice, if any, is
+  // over, until it's woken up.
+  void
+  suspend(std::size_t id) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    entries_[id].suspended = true;
+  }
+
+  void
+  wake(std::size_t id) {
+    std::lock_guard<std::mutex> lock{mutex_};
+    entries_[id].suspended = false;
+    enqueue(id);
+  }
+
+  // Run the queued machines on the given number of threads until the queue
+  // is empty.
+  void
+  run(unsigned threads) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < std::max(threads, 1u); ++t)
+      workers.emplace_back([this] { work(); });
+    work();
+    for (std::thread& worker : workers)
+      worker.join();
+  }
+
+  // Only to be called while the scheduler isn't running.
+  resumable_machine const&
+  machine(std::size_t id) const { return entries_[id].machine; }
+
+  // IDs of the machines that halted or used up their budgets, in that order.
+  std::vector<std::size_t> const&
+  finished() const { return finished_; }
+
+  std::size_t
+  slices() const { return slices_; }
+
+private:
+  struct entry {
+    resumable_machine machine;
+    unsigned priority;
+    std::size_t budget;
+    bool suspended = false;
+    bool queued = false;   // Or running
+  };
+
+  std::size_t quantum_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<entry> entries_;  // Which never moves the entries
+  std::deque<std::size_t> ready_;
+  std::vector<std::size_t> finished_;
+  std::size_t running_ = 0;
+  std::size_t slices_ = 0;
+
+  // With the mutex held.
+  void
+  enqueue(std::size_t id) {
+    entry& e = entries_[id];
+    bool const spent = e.budget > 0 && e.machine.steps() >= e.budget;
+    if (e.queued || e.suspended || e.machine.halted() || spent)
+      return;
+
+    e.queued = true;
+    ready_.push_back(id);
+    wake_.notify_one();
+  }
+
+  void
+  work() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    for (;;) {
+      wake_.wait(lock, [this] { return !ready_.empty() || running_ == 0; });
+      if (ready_.empty()) {
+        wake_.notify_all();
+        return;
+      }
+
+      std::size_t const id = ready_.front();
+      ready_.pop_front();
+      entry& e = entries_[id];
+      if (e.suspended) {
+        e.queued = false;
+        continue;
+      }
+
+      std::size_t quota = quantum_ * e.priority;
+      if (e.budget > 0)
+        quota = std::min(quota, e.budget - e.machine.steps());
+      ++running_;
+
+      lock.unlock();
+      e.machine.run_for(quota);
+      lock.lock();
+
+      --running_;
+      ++slices_;
+      e.queued = false;
+      if (e.machine.halted()
+          || (e.budget > 0 && e.machine.steps() >= e.budget))
+        finished_.push_back(id);
+      else
+        enqueue(id);
+      if (running_ == 0 && ready_.empty())
+        wake_.notify_all();
+    }
+  }
+};
+
+// Run a machine for each input, once each in one go and then by a scheduler
+// on all cores with slices of various sizes, and print what the scheduling
+// costs per step.
+template <typename State, typename Program>
+struct benchmark_scheduler {
+  static void
+  do_(std::vector<std::string> const& inputs) {
+    using clock = std::chrono::steady_clock;
+    unsigned const cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+    std::size_t steps = 0;
+    auto const start = clock::now();
+    for (std::string const& input : inputs)
+      steps += run_runtime<State, Program>::do_(runtime_tape{input}).steps;
+    std::chrono::duration<double> const straight = clock::now() - start;
+
+    std::cout << "-------------\n";
+    std::cout << inputs.size() << " machines, " << steps << " steps on "
+              << cores << " hardware threads:\n";
+    std::cout << "In one go:       " << 1e9 * straight.count() / steps
+              << " ns/step\n";
+
+    for (std::size_t quantum : {16, 256, 4096, 65536}) {
+      machine_scheduler scheduler{quantum};
+      for (std::string const& input : inputs)
+        scheduler.add(
+          resumable_machine::start<State, Program>(runtime_tape{input})
+        );
+
+      auto const start = clock::now();
+      scheduler.run(cores);
+      std::chrono::duration<double> const elapsed = clock::now() - start;
+
+      std::size_t scheduled = 0;
+      for (std::size_t id = 0; id < inputs.size(); ++id)
+        scheduled += scheduler.machine(id).steps();
+      std::cout << "Slices of " << quantum << ": "
+                << 1e9 * elapsed.count() * cores / steps << " ns/step over "
+                << scheduler.slices() << " slices\n";
+      if (scheduled != steps)
+        std::cout << "The scheduler disagrees!\n";
+    }
+  }
+};
+
+//
+// Batch execution: One acceptor is often run on a great many input words,
+// each of which can be run independently of the others. The words are split
+// evenly between worker threads, but some words take much longer than others,
+// so a worker that runs out of its own words steals half of the remaining
+// words of another worker.
+//
+
+namespace detail {
+  // The words a worker has yet to run. The owner takes words from the front,
+  // thieves take from the back.
+  struct job_range {
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    bool
+    take(std::size_t& job) {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (begin == end)
+        return false;
+      job = begin++;
+      return true;
+    }
+
+    // Move half of victim's jobs over to this range, which must be empty.
+    bool
+    steal(job_range& victim) {
+      std::scoped_lock lock{mutex, victim.mutex};
+      if (victim.begin == victim.end)
+        return false;
+      end = victim.end;
+      begin = victim.end = victim.end - (victim.end - victim.begin + 1) / 2;
+      return true;
+    }
+  };
+}  // end namespace detail
+
+// Outcome of running one word of a batch.
+struct batch_result {
+  bool accepted;
+  char const* state_name;
+  std::size_t steps;
+  std::string tape;  // Formatted as by print_tape; only if requested
+};
+
+// Run the program from the given state on every input using the given number
+// of threads. The results are in the order of the inputs.
+template <
+  typename State, typename Program, typename Engine = compiled_engine
+>
+struct run_batch {
+  static std::vector<batch_result>
+  do_(std::vector<std::string> const& inputs, unsigned threads,
+      bool keep_tapes = false) {
+    threads = std::max(threads, 1u);
+    std::vector<batch_result> results(inputs.size());
+    std::vector<detail::job_range> ranges(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+      ranges[t].begin = inputs.size() * t / threads;
+      ranges[t].end = inputs.size() * (t + 1) / threads;
+    }
+
+    auto const work = [&] (unsigned self) {
+      for (;;) {
+        std::size_t job;
+        while (ranges[self].take(job)) {
+          auto const result =
+            Engine::template run<State, Program>::do_(
+              typename Engine::tape{inputs[job]}
+            );
+          results[job] = {
+            result.final, result.state_name, result.steps,
+            keep_tapes ? result.tape.str() : std::string{}
+          };
+        }
+
+        bool stolen = false;
+        for (unsigned t = 1; t < threads && !stolen; ++t)
+          stolen = ranges[self].steal(ranges[(self + t) % threads]);
+        if (!stolen)
+          return;
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+      workers.emplace_back(work, t);
+    work(0);
+    for (std::thread& worker : workers)
+      worker.join();
+
+    return results;
+  }
+};
+
+// Run the same batch with 1, 2, 4, ... threads up to the number of cores and
+// print the throughput of each.
+template <typename State, typename Program>
+struct benchmark_batch {
+  static void
+  do_(std::vector<std::string> const& inputs) {
+    unsigned const cores = std::max(std::thread::hardware_concurrency(), 1u);
+    std::cout << "-------------\n";
+    std::cout << inputs.size() << " words on " << cores
+              << " hardware threads:\n";
+
+    for (unsigned threads = 1; ; threads = std::min(2 * threads, cores)) {
+      auto const start = std::chrono::steady_clock::now();
+      std::vector<batch_result> const results =
+        run_batch<State, Program>::do_(inputs, threads);
+      std::chrono::duration<double> const elapsed =
+        std::chrono::steady_clock::now() - start;
+
+      std::size_t const accepted =
+        std::count_if(results.begin(), results.end(),
+                      [] (batch_result const& r) { return r.accepted; });
+      std::cout << threads << " threads: " << inputs.size() / elapsed.count()
+                << " words/s (" << accepted << " accepted)\n";
+
+      if (threads == cores)
+        break;
+    }
+  }
+};
+
+//
+// Enumerating programs: Searching a program space -- all machines of n
+// states over the empty symbol and '1', say -- for ones with a particular
+// halting behaviour means running a great many small machines on an empty
+// tape. Rather than generating every transition table there is, the tables
+// are grown in tree normal form: a machine starts out with no transitions at
+// all and is run until it needs one it doesn't have. It's then copied once for
+// each transition it could have there, and the copies are run in turn.
+// Transitions a machine never needs are never filled in, so each machine
+// enumerated stands for all those that differ from it only in those.
+//
+// Two kinds of duplicates are pruned on the way. A new transition may go to
+// any state used so far or to the first state not used yet, never to a later
+// one, as that would only rename the states. And as every machine has a
+// mirror image that moves the other way, only machines whose first move is to
+// the right are enumerated.
+//
+// Instead of being filled in, a missing transition can also halt the machine
+// by going to the final state Z, writing '1' and moving to the right, which
+// counts as a step. Machines are run with a step cap and the checks of
+// run_checked. Those found never to halt are dropped and the others are
+// passed on as soon as they're found. The tree is split into subtrees that
+// worker threads run, stealing subtrees from each other as in run_batch.
+//
+
+struct enumeration_options {
+  std::size_t states = 2;
+  std::size_t max_steps = 1000;  // Undecided if still running after that
+  std::size_t min_steps = 0;     // Halting machines making fewer are dropped
+  bool undecided = true;         // Whether to pass undecided machines on
+  unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+  divergence_options checks;
+};
+
+namespace detail {
+  // A machine of the enumeration, with the members of a transition_table.
+  // The instruction for state S and symbol C is the one at 2 * S + C, where C
+  // is 1 for '1' and 0 for anything else. Its target is npos as long as it
+  // hasn't been filled in. The last state is the final one.
+  struct enumerated_table {
+    std::size_t state_count;
+    std::vector<char> writes;
+    std::vector<char> moves;
+    std::vector<std::size_t> targets;
+    std::vector<bool> finals;
+
+    explicit
+    enumerated_table(std::size_t states)
+      : state_count(states + 1)
+      , writes(2 * states, empty)
+      , moves(2 * states, '0')
+      , targets(2 * states, npos)
+      , finals(states + 1)
+    {
+      finals[states] = true;
+    }
+
+    std::size_t
+    find(std::size_t state, char head) const {
+      std::size_t const i = 2 * state + (head == '1');
+      return targets[i] != npos ? i : npos;
+    }
+  };
+
+  // A machine waiting to be run, and how many of its states -- always the
+  // first ones -- it uses.
+  struct enumeration_node {
+    enumerated_table table;
+    std::size_t used;
+  };
+
+  // Each worker's own, on a cache line of its own.
+  struct alignas(64) enumeration_counts {
+    std::size_t machines = 0;
+    std::size_t halted = 0;
+    std::size_t diverged = 0;
+    std::size_t undecided = 0;
+  };
+}  // end namespace detail
+
+// A machine found by enumerate_programs.
+struct enumerated_program {
+  detail::enumerated_table table;
+  bool halted;
+  std::size_t steps;
+  std::size_t ones;  // Left on the tape
+
+  // In the usual notation, such as 1RB1LB_1LA1RZ: for each state, what it
+  // does on 0 (the empty symbol) and on 1, with --- for transitions the
+  // machine never needs.
+  std::string
+  str() const {
+    std::string out;
+    for (std::size_t i = 0; i < table.targets.size(); ++i) {
+      if (i > 0 && i % 2 == 0)
+        out += '_';
+      if (table.targets[i] == detail::npos) {
+        out += "---";
+        continue;
+      }
+      out += table.writes[i] == '1' ? '1' : '0';
+      out += table.moves[i];
+      out += name(table.targets[i]);
+    }
+    return out;
+  }
+
+  // As a text that loaded_program::parse reads.
+  std::string
+  text() const {
+    std::string out = "// " + str() + "\nstart A\nfinal Z\n";
+    for (std::size_t i = 0; i < table.targets.size(); ++i)
+      if (table.targets[i] != detail::npos) {
+        out += name(i / 2);
+        out += i % 2 ? " 1 " : " # ";
+        out += name(table.targets[i]);
+        out += ' ';
+        out += table.writes[i];
+        out += ' ';
+        out += table.moves[i];
+        out += '\n';
+      }
+    return out;
+  }
+
+private:
+  char
+  name(std::size_t state) const {
+    return state + 1 == table.state_count
+      ? 'Z' : static_cast<char>('A' + state);
+  }
+};
+
+struct enumeration_stats {
+  std::size_t machines = 0;   // Halted, diverged and undecided together
+  std::size_t halted = 0;
+  std::size_t diverged = 0;
+  std::size_t undecided = 0;
+  double seconds = 0;
+};
+
+// Enumerate the machines of options.states states, calling on_program with
+// every one that halts after at least options.min_steps steps and, if
+// options.undecided is set, every one that makes options.max_steps steps
+// without halting or being found never to halt. on_program is called from
+// one thread at a time.
+struct enumerate_programs {
+  template <typename OnProgram>
+  static enumeration_stats
+  do_(enumeration_options const& options, OnProgram&& on_program) {
+    if (options.states == 0 || options.states > 25)
+      throw std::runtime_error{"Can only enumerate 1 to 25 states"};
+
+    auto const start = std::chrono::steady_clock::now();
+    unsigned const threads = std::max(options.threads, 1u);
+
+    std::mutex output;
+    auto const found = [&] (enumerated_program&& program) {
+      std::lock_guard<std::mutex> lock{output};
+      on_program(std::move(program));
+    };
+
+    // Grow the top of the tree breadth first, until there are enough
+    // subtrees for the workers to share.
+    std::vector<detail::enumeration_counts> counts(threads);
+    std::vector<detail::enumeration_node> subtrees{
+      {detail::enumerated_table{options.states}, 1}
+    };
+    while (!subtrees.empty() && subtrees.size() < 16 * threads) {
+      std::vector<detail::enumeration_node> next;
+      for (detail::enumeration_node const& node : subtrees)
+        grow(node, options, counts[0], found,
+             [&] (detail::enumeration_node&& child) {
+               next.push_back(std::move(child));
+             });
+      subtrees = std::move(next);
+    }
+
+    std::vector<detail::job_range> ranges(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+      ranges[t].begin = subtrees.size() * t / threads;
+      ranges[t].end = subtrees.size() * (t + 1) / threads;
+    }
+
+    auto const work = [&] (unsigned self) {
+      std::vector<detail::enumeration_node> stack;
+      auto const push = [&] (detail::enumeration_node&& child) {
+        stack.push_back(std::move(child));
+      };
+
+      for (;;) {
+        std::size_t job;
+        while (ranges[self].take(job)) {
+          stack.push_back(subtrees[job]);
+          while (!stack.empty()) {
+            detail::enumeration_node const node = std::move(stack.back());
+            stack.pop_back();
+            grow(node, options, counts[self], found, push);
+          }
+        }
+
+        bool stolen = false;
+        for (unsigned t = 1; t < threads && !stolen; ++t)
+          stolen = ranges[self].steal(ranges[(self + t) % threads]);
+        if (!stolen)
+          return;
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t)
+      workers.emplace_back(work, t);
+    work(0);
+    for (std::thread& worker : workers)
+      worker.join();
+
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    enumeration_stats stats;
+    for (detail::enumeration_counts const& c : counts) {
+      stats.machines += c.machines;
+      stats.halted += c.halted;
+      stats.diverged += c.diverged;
+      stats.undecided += c.undecided;
+    }
+    stats.seconds = elapsed.count();
+    return stats;
+  }
+
+private:
+  // Run the machine, and either pass it on to found, drop it, or pass the
+  // machines it can be grown into on to child.
+  template <typename Found, typename Child>
+  static void
+  grow(detail::enumeration_node const& node,
+       enumeration_options const& options,
+       detail::enumeration_counts& counts, Found const& found,
+       Child const& child) {
+    std::size_t state = 0;
+    bool final = false;
+    std::size_t steps = 0;
+    runtime_tape tape{""};
+    divergence const diverges = detail::run_checked_loop(
+      node.table, state, final, tape, steps, options.checks,
+      options.max_steps
+    );
+
+    auto const ones = [&tape] {
+      std::string const cells = tape.visited();
+      return static_cast<std::size_t>(
+        std::count(cells.begin(), cells.end(), '1')
+      );
+    };
+
+    if (diverges != divergence::none) {
+      ++counts.machines;
+      ++counts.diverged;
+      return;
+    }
+    if (steps == options.max_steps) {
+      ++counts.machines;
+      ++counts.undecided;
+      if (options.undecided)
+        found({node.table, false, steps, ones()});
+      return;
+    }
+
+    // The machine needs the instruction at i.
+    std::size_t const i = 2 * state + (tape.head() == '1');
+
+    ++counts.machines;
+    ++counts.halted;
+    if (steps + 1 >= options.min_steps) {
+      enumerated_program halting{
+        node.table, true, steps + 1, ones() + (tape.head() != '1')
+      };
+      halting.table.targets[i] = options.states;
+      halting.table.writes[i] = '1';
+      halting.table.moves[i] = 'R';
+      found(std::move(halting));
+    }
+
+    // The first instruction goes right to the second state; staying in the
+    // first one, the machine would never halt.
+    bool const first = steps == 0;
+    std::size_t const from = first ? 1 : 0;
+    std::size_t const to =
+      std::min(first ? 2 : node.used + 1, options.states);
+    for (std::size_t target = from; target < to; ++target)
+      for (char const write : {empty, '1'})
+        for (char const move : {'L', 'R'}) {
+          if (first && move == 'L')
+            continue;
+
+          detail::enumeration_node next = node;
+          next.table.targets[i] = target;
+          next.table.writes[i] = write;
+          next.table.moves[i] = move;
+          next.used = std::max(node.used, target + 1);
+          child(std::move(next));
+        }
+  }
+};
+
+// Define TURING_MACHINE_NO_MAIN to include this file into another program,
+// such as the machines generated by compile-benchmark.cpp.
+#ifndef TURING_MACHINE_NO_MAIN
+int main() {
+  std::cout << "Input reversal machine:\n";
+  std::cout << "=======================\n";
+
+  struct put_right_marker : state<> { };
+  struct rewind : state<> { };
+  struct go_right_a : state<> { };
+  struct go_right_b : state<> { };
+  struct go_left_a : state<> { };
+  struct go_left_b : state<> { };
+  struct take_left : state<> { };
+  struct take_right : state<> { };
+  struct clear : state<> { };
+  struct clear_a : state<> { };
+  struct clear_b : state<> { };
+  struct clear_last : state<> { };
+  struct end : state<true> { };
+
+  using reverse_prog = program<
+    instruction<put_right_marker,   '#', rewind,            '|', 'L'>,
+    instruction<put_right_marker,   '?', put_right_marker,  '?', 'R'>,
+
+    instruction<rewind,             '#', take_left,         '#', 'R'>,
+    instruction<rewind,             '?', rewind,            '?', 'L'>,
+
+    instruction<take_left,          'a', go_right_a,        '|', 'R'>,
+    instruction<take_left,          'b', go_right_b,        '|', 'R'>,
+    instruction<take_left,          '|', clear,             '|', 'R'>,
+    
+    instruction<go_right_a,         '|', take_right,        'a', 'L'>,
+    instruction<go_right_b,         '|', take_right,        'b', 'L'>,
+    instruction<go_right_a,         '?', go_right_a,        '?', 'R'>,
+    instruction<go_right_b,         '?', go_right_b,        '?', 'R'>,
+
+    instruction<take_right,         'a', go_left_a,         '|', 'L'>,
+    instruction<take_right,         'b', go_left_b,         '|', 'L'>,
+    instruction<take_right,         '|', clear,             '|', 'R'>,
+
+    instruction<go_left_a,          '|', take_left,         'a', 'R'>,
+    instruction<go_left_b,          '|', take_left,         'b', 'R'>,
+    instruction<go_left_a,          '?', go_left_a,         '?', 'L'>,
+    instruction<go_left_b,          '?', go_left_b,         '?', 'L'>,
+    
+    instruction<clear,              'a', clear_a,           '|', 'L'>,
+    instruction<clear,              'b', clear_b,           '|', 'L'>,
+    instruction<clear,              '|', clear,             '|', 'R'>,
+    instruction<clear,              '#', clear_last,        '#', 'L'>,
+    instruction<clear_a,            '|', clear,             'a', 'R'>,
+    instruction<clear_b,            '|', clear,             'b', 'R'>,
+    instruction<clear_last,         '|', end,               '#', '0'>
+  >;
+
+  using reverse_tape1 = make_tape<'a', 'b', 'a', 'a', 'b', 'b', 'a'>::type;
+  using reverse_tape2 = make_tape<'a'>::type;
+  using reverse_tape3 = make_tape<'a', 'b'>::type;
+  using reverse_tape4 = make_tape<>::type;
+
+  execute<machine<put_right_marker, reverse_tape1, reverse_prog>>::do_();
+  execute<machine<put_right_marker, reverse_tape2, reverse_prog>>::do_();
+  execute<machine<put_right_marker, reverse_tape3, reverse_prog>>::do_();
+  execute<machine<put_right_marker, reverse_tape4, reverse_prog>>::do_();
+
+  std::cout << "\n";
+  std::cout << "Acceptor of { a^n b^n c^n : n >= 0 }:\n";
+  std::cout << "=====================================\n";
+
+  struct check_a  : state<> { };
+  struct check_b  : state<> { };
   struct check_c  : state<> { };
   struct find_end : state<> { };
   struct accept   : state<true> { };
@@ -490,6 +4992,8 @@ int main() {
   using lang_tape5 = make_tape<'a', 'a', 'b', 'b', 'c', 'c', 'c'>::type;
   using lang_tape6 = make_tape<'a', 'a', 'b', 'b', 'c'>::type;
   using lang_tape7 = make_tape<'a', 'b', 'c', 'a', 'b', 'c'>::type;
+  using lang_tape8 = make_tape<'a'>::type;
+  using lang_tape9 = make_tape<'a', 'a', 'b'>::type;
   
   execute<machine<check_a, lang_tape1, lang_prog>>::do_();
   execute<machine<check_a, lang_tape2, lang_prog>>::do_();
@@ -498,5 +5002,656 @@ int main() {
   execute<machine<check_a, lang_tape5, lang_prog>>::do_();
   execute<machine<check_a, lang_tape6, lang_prog>>::do_();
   execute<machine<check_a, lang_tape7, lang_prog>>::do_();
-}
+  execute<machine<check_a, lang_tape8, lang_prog>>::do_();
+  execute<machine<check_a, lang_tape9, lang_prog>>::do_();
+
+  std::cout << "\n";
+  std::cout << "Binary to unary converter:\n";
+  std::cout << "==========================\n";
+
+  // Counts a binary number down to zero, appending a '1' to the right end of
+  // the tape for every decrement. Takes a number of steps quadratic in the
+  // value of the input.
+  struct find_lsb : state<> { };
+  struct decrement : state<> { };
+  struct tally : state<> { };
+  struct back : state<> { };
+  struct zero_out : state<> { };
+  struct done : state<true> { };
+  using unary_prog = program<
+    instruction<find_lsb,   '|', decrement, '|', 'L'>,
+    instruction<find_lsb,   '?', find_lsb,  '?', 'R'>,
+    instruction<decrement,  '1', tally,     '0', 'R'>,
+    instruction<decrement,  '0', decrement, '1', 'L'>,
+    instruction<decrement,  '#', zero_out,  '#', 'R'>,
+    instruction<tally,      '#', back,      '1', 'L'>,
+    instruction<tally,      '?', tally,     '?', 'R'>,
+    instruction<back,       '|', decrement, '|', 'L'>,
+    instruction<back,       '?', back,      '?', 'L'>,
+    instruction<zero_out,   '1', zero_out,  '0', 'R'>,
+    instruction<zero_out,   '|', done,      '|', '0'>
+  >;
+
+  using unary_tape1 = make_tape<'1', '0', '1', '|'>::type;
+  using unary_tape2 = make_tape<'1', '0', '1', '0', '0', '0', '|'>::type;
+
+  execute<machine<find_lsb, unary_tape1, unary_prog>>::do_();
+  execute<machine<find_lsb, unary_tape2, unary_prog>>::do_();
+
+  // Not enough fuel to count all the way down.
+  using bounded = run_bounded<machine<find_lsb, unary_tape2, unary_prog>, 100>;
+  static_assert(bounded::out_of_fuel && !bounded::accepted,
+                "The machine shouldn't have halted yet");
+  std::cout << "-------------\n";
+  print_result<bounded>::do_();
+
+  // But enough for a smaller number.
+  static_assert(
+    run_bounded<machine<find_lsb, unary_tape1, unary_prog>, 100>::accepted,
+    "The machine should have halted"
+  );
+
+  std::cout << "\n";
+  std::cout << "Optimized programs:\n";
+  std::cout << "===================\n";
+
+  // The converter again, as a careless generator might have put it out.
+  struct start_over : state<> { };
+  struct unused : state<> { };
+  using sloppy_prog = program<
+    instruction<start_over, '1', find_lsb,  '?', '0'>,
+    instruction<find_lsb,   '|', decrement, '|', 'L'>,
+    instruction<find_lsb,   '?', find_lsb,  '?', 'R'>,
+    instruction<find_lsb,   '0', find_lsb,  '0', 'R'>,
+    instruction<decrement,  '1', tally,     '0', 'R'>,
+    instruction<decrement,  '0', decrement, '1', 'L'>,
+    instruction<decrement,  '#', zero_out,  '#', 'R'>,
+    instruction<decrement,  '1', done,      '1', '0'>,
+    instruction<tally,      '#', back,      '1', 'L'>,
+    instruction<tally,      '?', tally,     '?', 'R'>,
+    instruction<back,       '|', decrement, '|', 'L'>,
+    instruction<back,       '?', back,      '?', 'L'>,
+    instruction<zero_out,   '1', zero_out,  '0', 'R'>,
+    instruction<zero_out,   '|', done,      '|', '0'>,
+    instruction<unused,     '?', done,      '?', '0'>
+  >;
+
+  using sloppy = optimize<sloppy_prog, start_over>;
+  static_assert(sloppy::removed == 3 && sloppy::merged == 1,
+                "Unexpected optimization");
+  sloppy::report();
+
+  using sloppy_run =
+    run_constexpr<machine<start_over, unary_tape2, sloppy_prog>>;
+  using optimized_run =
+    run_constexpr<machine<start_over, unary_tape2, sloppy::type>>;
+  static_assert(
+    std::is_same<
+      sloppy_run::result::tape, optimized_run::result::tape
+    >::value,
+    "The optimized program doesn't do the same"
+  );
+  execute<machine<start_over, unary_tape2, sloppy::type>>::do_();
+  std::cout << "Steps: " << sloppy_run::steps << " before, "
+            << optimized_run::steps << " after\n";
+
+  std::cout << "\n";
+  std::cout << "Two-tape machines:\n";
+  std::cout << "==================\n";
+
+  // Reverses the input in linearly many steps: copies it onto the second
+  // tape, rewinds the first one and copies the second one back backwards.
+  struct copy : state<> { };
+  struct copy_back : state<> { };
+  using reverse2_prog = multi_program<
+    multi_instruction<copy, symbols<'a', '#'>, copy,
+                      symbols<'a', 'a'>, movements<'R', 'R'>>,
+    multi_instruction<copy, symbols<'b', '#'>, copy,
+                      symbols<'b', 'b'>, movements<'R', 'R'>>,
+    multi_instruction<copy, symbols<'#', '#'>, rewind,
+                      symbols<'?', '?'>, movements<'L', 'L'>>,
+
+    multi_instruction<rewind, symbols<'#', '?'>, copy_back,
+                      symbols<'?', '?'>, movements<'R', '0'>>,
+    multi_instruction<rewind, symbols<'?', '?'>, rewind,
+                      symbols<'?', '?'>, movements<'L', '0'>>,
+
+    multi_instruction<copy_back, symbols<'?', 'a'>, copy_back,
+                      symbols<'a', '?'>, movements<'R', 'L'>>,
+    multi_instruction<copy_back, symbols<'?', 'b'>, copy_back,
+                      symbols<'b', '?'>, movements<'R', 'L'>>,
+    multi_instruction<copy_back, symbols<'?', '#'>, end,
+                      symbols<'?', '?'>, movements<'0', '0'>>
+  >;
+
+  using reverse2_machine = multi_machine<
+    copy, tapes<reverse_tape1, make_tape<>::type>, reverse2_prog
+  >;
+  execute_multi<reverse2_machine>::do_();
+  execute_multi<
+    multi_machine<copy, tapes<reverse_tape4, make_tape<>::type>, reverse2_prog>
+  >::do_();
+  std::cout << "The single-tape machine takes "
+            << run_constexpr<
+                 machine<put_right_marker, reverse_tape1, reverse_prog>
+               >::steps
+            << " steps\n";
+
+  // Counts the a's on the second tape, then counts them off against the b's
+  // going back and against the c's going forth again. Only the empty input
+  // is accepted right away; once an a has been counted, the input running
+  // out is no reason to.
+  struct check_empty : state<> { };
+  struct count_a : state<> { };
+  struct match_b : state<> { };
+  struct match_c : state<> { };
+  using lang2_prog = multi_program<
+    multi_instruction<check_empty, symbols<'#', '#'>, accept,
+                      symbols<'?', '?'>, movements<'0', '0'>>,
+    multi_instruction<check_empty, symbols<'?', '?'>, count_a,
+                      symbols<'?', '?'>, movements<'0', '0'>>,
+    multi_instruction<count_a, symbols<'a', '#'>, count_a,
+                      symbols<'?', 'x'>, movements<'R', 'R'>>,
+    multi_instruction<count_a, symbols<'b', '#'>, match_b,
+                      symbols<'?', '?'>, movements<'0', 'L'>>,
+    multi_instruction<match_b, symbols<'b', 'x'>, match_b,
+                      symbols<'?', '?'>, movements<'R', 'L'>>,
+    multi_instruction<match_b, symbols<'c', '#'>, match_c,
+                      symbols<'?', '?'>, movements<'0', 'R'>>,
+    multi_instruction<match_c, symbols<'c', 'x'>, match_c,
+                      symbols<'?', '?'>, movements<'R', 'R'>>,
+    multi_instruction<match_c, symbols<'#', '#'>, accept,
+                      symbols<'?', '?'>, movements<'0', '0'>>
+  >;
+
+  execute_multi<
+    multi_machine<check_empty, tapes<lang_tape1, make_tape<>::type>, lang2_prog>
+  >::do_();
+  execute_multi<
+    multi_machine<check_empty, tapes<lang_tape3, make_tape<>::type>, lang2_prog>
+  >::do_();
+  execute_multi<
+    multi_machine<check_empty, tapes<lang_tape6, make_tape<>::type>, lang2_prog>
+  >::do_();
+  execute_multi<
+    multi_machine<check_empty, tapes<lang_tape7, make_tape<>::type>, lang2_prog>
+  >::do_();
+  execute_multi<
+    multi_machine<check_empty, tapes<lang_tape8, make_tape<>::type>, lang2_prog>
+  >::do_();
+  execute_multi<
+    multi_machine<check_empty, tapes<lang_tape9, make_tape<>::type>, lang2_prog>
+  >::do_();
+  std::cout << "The single-tape machine takes "
+            << run_constexpr<machine<check_a, lang_tape1, lang_prog>>::steps
+            << " steps on the first input\n";
+
+  std::cout << "\n";
+  std::cout << "The same machines on the constexpr engine:\n";
+  std::cout << "==========================================\n";
+
+  using flat = constexpr_engine<>;
+  execute<machine<put_right_marker, reverse_tape1, reverse_prog>, flat>::do_();
+  execute<machine<put_right_marker, reverse_tape4, reverse_prog>, flat>::do_();
+  execute<machine<check_a, lang_tape1, lang_prog>, flat>::do_();
+  execute<machine<check_a, lang_tape7, lang_prog>, flat>::do_();
+  execute<machine<find_lsb, unary_tape2, unary_prog>, flat>::do_();
+
+  std::cout << "\n";
+  std::cout << "The same machines on the runtime engine:\n";
+  std::cout << "========================================\n";
+
+  execute_runtime<put_right_marker, reverse_prog>::do_("abaabba");
+  execute_runtime<put_right_marker, reverse_prog>::do_("");
+  execute_runtime<check_a, lang_prog>::do_("aaabbbccc");
+  execute_runtime<check_a, lang_prog>::do_("abcabc");
+  execute_runtime<find_lsb, unary_prog>::do_("101000|");
+
+  // An input that only exists at runtime, far too long for either of the
+  // compile-time engines.
+  std::string long_input;
+  for (std::size_t i = 0; i < 200; ++i)
+    long_input += i % 3 == 0 ? 'b' : 'a';
+  execute_runtime<put_right_marker, reverse_prog>::do_(long_input);
+
+  std::cout << "\n";
+  std::cout << "The compiled runtime engine:\n";
+  std::cout << "============================\n";
+
+  execute_runtime<put_right_marker, reverse_prog, compiled_engine>::do_(
+    "abaabba"
+  );
+  execute_runtime<check_a, lang_prog, compiled_engine>::do_("aaabbbccc");
+  execute_runtime<check_a, lang_prog, compiled_engine>::do_("abcabc");
+  execute_runtime<find_lsb, unary_prog, compiled_engine>::do_("101000|");
+
+  std::string bench_input;
+  for (std::size_t i = 0; i < 2000; ++i)
+    bench_input += i % 3 == 0 ? 'b' : 'a';
+  compare_runtime_engines<put_right_marker, reverse_prog>::do_(bench_input);
+
+  std::cout << "\n";
+  std::cout << "The run-length encoded runtime engine:\n";
+  std::cout << "======================================\n";
+
+  execute_runtime<put_right_marker, reverse_prog, rle_engine>::do_("abaabba");
+  execute_runtime<check_a, lang_prog, rle_engine>::do_("aaabbbccc");
+  execute_runtime<find_lsb, unary_prog, rle_engine>::do_("101000|");
+
+  // Counting down from 2^12 tallies 4096 ones in a single run.
+  compare_runtime_engines<find_lsb, unary_prog>::do_(
+    "1" + std::string(12, '0') + "|"
+  );
+
+  std::cout << "\n";
+  std::cout << "Warm starts:\n";
+  std::cout << "============\n";
+
+  {
+    // Counting down from 2^10, the first 20000 steps made at compile time.
+    using unary_tape3 = make_tape<
+      '1', '0', '0', '0', '0', '0', '0', '0', '0', '0', '0', '|'
+    >::type;
+    using warm = warm_start<machine<find_lsb, unary_tape3, unary_prog>, 20000>;
+    static_assert(warm::steps == 20000, "Unexpected step count");
+
+    runtime_result<> const cold =
+      run_runtime<find_lsb, unary_prog>::do_(runtime_tape{"10000000000|"});
+    runtime_result<> const interpreted = warm::resume();
+    runtime_result<> const compiled = warm::resume<compiled_engine>();
+    runtime_result<rle_tape> const rle = warm::resume<rle_engine>();
+
+    std::cout << "-------------\n";
+    std::cout << warm::steps << " of " << cold.steps
+              << " steps made at compile time, " << warm::cells.size()
+              << " cells visited\n";
+    std::cout << "From scratch: " << cold.seconds << " s\n";
+    std::cout << "Warm:         " << interpreted.seconds << " s\n";
+    for (bool const same : {
+           interpreted.steps == cold.steps
+             && interpreted.tape.str() == cold.tape.str()
+             && interpreted.state_name == std::string{cold.state_name},
+           compiled.steps == cold.steps
+             && compiled.tape.str() == cold.tape.str(),
+           rle.steps == cold.steps && rle.tape.str() == cold.tape.str()
+         })
+      if (!same)
+        std::cout << "The warm start disagrees!\n";
+
+    // A machine that halts during compilation leaves nothing to do.
+    using done = warm_start<
+      machine<put_right_marker, reverse_tape1, reverse_prog>, 1000
+    >;
+    runtime_result<> const rest = done::resume();
+    runtime_result<> const reversed =
+      run_runtime<put_right_marker, reverse_prog>::do_(runtime_tape{"abaabba"});
+    std::cout << "The reversal machine halts after " << done::steps
+              << " steps at compile time, "
+              << rest.steps - done::steps << " are left for runtime\n";
+    if (rest.steps != reversed.steps || !rest.final
+        || rest.tape.str() != reversed.tape.str())
+      std::cout << "The warm start disagrees!\n";
+  }
+
+  std::cout << "\n";
+  std::cout << "Profiles:\n";
+  std::cout << "=========\n";
+
+  // Taken at compile time.
+  using reverse_run = run<machine<put_right_marker, reverse_tape1, reverse_prog>>;
+  static_assert(reverse_run::profile.steps == 66, "Unexpected step count");
+  profile_report<reverse_prog>::json(std::cout, reverse_run::profile);
+
+  profiled_result<reverse_prog> const profiled =
+    run_profiled<put_right_marker, reverse_prog>::do_(runtime_tape{long_input});
+  profile_report<reverse_prog>::csv(
+    std::cout, profiled.profile, profiled.state_seconds.data()
+  );
+
+  std::cout << "\n";
+  std::cout << "Machines loaded from files:\n";
+  std::cout << "===========================\n";
+
+  std::filesystem::path const program_file =
+    std::filesystem::temp_directory_path() / "turing-machine-reverse.tm";
+  std::filesystem::path const input_file =
+    std::filesystem::temp_directory_path() / "turing-machine-input.txt";
+
+  // The reversal machine once more, this time as text.
+  std::ofstream{program_file}
+    << "// The input reversal machine\n"
+    << "start put_right_marker\n"
+    << "final end\n"
+    << "put_right_marker  #  rewind            |  L\n"
+    << "put_right_marker  ?  put_right_marker  ?  R\n"
+    << "rewind            #  take_left         #  R\n"
+    << "rewind            ?  rewind            ?  L\n"
+    << "take_left         a  go_right_a        |  R\n"
+    << "take_left         b  go_right_b        |  R\n"
+    << "take_left         |  clear             |  R\n"
+    << "go_right_a        |  take_right        a  L\n"
+    << "go_right_b        |  take_right        b  L\n"
+    << "go_right_a        ?  go_right_a        ?  R\n"
+    << "go_right_b        ?  go_right_b        ?  R\n"
+    << "take_right        a  go_left_a         |  L\n"
+    << "take_right        b  go_left_b         |  L\n"
+    << "take_right        |  clear             |  R\n"
+    << "go_left_a         |  take_left         a  R\n"
+    << "go_left_b         |  take_left         b  R\n"
+    << "go_left_a         ?  go_left_a         ?  L\n"
+    << "go_left_b         ?  go_left_b         ?  L\n"
+    << "clear             a  clear_a           |  L\n"
+    << "clear             b  clear_b           |  L\n"
+    << "clear             |  clear             |  R\n"
+    << "clear             #  clear_last        #  L\n"
+    << "clear_a           |  clear             a  R\n"
+    << "clear_b           |  clear             b  R\n"
+    << "clear_last        |  end               #  0\n";
+  std::ofstream{input_file} << "abaabba\n";
+
+  loaded_program const loaded = loaded_program::load(program_file.string());
+  std::cout << "-------------\n";
+  print_runtime_result::do_(
+    run_loaded::do_(loaded, mapped_tape{input_file.string()})
+  );
+  print_runtime_result::do_(
+    run_loaded::do_(loaded, runtime_tape{long_input})
+  );
+
+  std::filesystem::remove(program_file);
+  std::filesystem::remove(input_file);
+
+  std::cout << "\n";
+  std::cout << "Machines that never halt:\n";
+  std::cout << "=========================\n";
+
+  struct ping : state<> { };
+  struct pong : state<> { };
+  using ping_pong_prog = program<
+    instruction<ping, '?', pong, '?', 'R'>,
+    instruction<pong, '?', ping, '?', 'L'>
+  >;
+  print_checked_result::do_(
+    run_checked<ping, ping_pong_prog>::do_(runtime_tape{"ab"})
+  );
+
+  // Writes "ab" over and over to the right.
+  struct write_a : state<> { };
+  struct write_b : state<> { };
+  using ab_prog = program<
+    instruction<write_a, '?', write_b, 'a', 'R'>,
+    instruction<write_b, '?', write_a, 'b', 'R'>
+  >;
+  print_checked_result::do_(
+    run_checked<write_a, ab_prog>::do_(runtime_tape{"xyz"})
+  );
+
+  // Steps back now and then, but still makes its way to the right.
+  struct zig : state<> { };
+  struct zag : state<> { };
+  struct zog : state<> { };
+  using zigzag_prog = program<
+    instruction<zig, '#', zag, 'z', 'R'>,
+    instruction<zig, '?', zig, '?', 'R'>,
+    instruction<zag, '?', zog, '?', 'L'>,
+    instruction<zog, '?', zig, '?', 'R'>
+  >;
+  print_checked_result::do_(
+    run_checked<zig, zigzag_prog>::do_(runtime_tape{"abc"})
+  );
+
+  // What the checks cost on a machine that does halt.
+  {
+    runtime_result<> const plain =
+      run_runtime<put_right_marker, reverse_prog>::do_(
+        runtime_tape{bench_input}
+      );
+    checked_result const checked =
+      run_checked<put_right_marker, reverse_prog>::do_(
+        runtime_tape{bench_input}
+      );
+    std::cout << "-------------\n";
+    std::cout << "Unchecked: " << plain.steps / plain.seconds << " steps/s\n";
+    std::cout << "Checked:   " << checked.steps / checked.seconds
+              << " steps/s\n";
+    if (checked.steps != plain.steps
+        || checked.diverges != divergence::none)
+      std::cout << "The engines disagree!\n";
+  }
+
+  std::cout << "\n";
+  std::cout << "Checkpoints:\n";
+  std::cout << "============\n";
+
+  {
+    std::filesystem::path const checkpoint_file =
+      std::filesystem::temp_directory_path() / "turing-machine.checkpoint";
+    checkpoint_options const options{checkpoint_file.string(), 100000};
+
+    using checkpointed = run_checkpointed<put_right_marker, reverse_prog>;
+    runtime_result<> const plain =
+      run_runtime<put_right_marker, reverse_prog>::do_(
+        runtime_tape{bench_input}
+      );
+    runtime_result<> const whole =
+      checkpointed::do_(runtime_tape{bench_input}, options);
+
+    // Picked up again from the last checkpoint, as though the run had been
+    // interrupted right after saving it.
+    checkpoint const last = checkpoint::load(options.path);
+    runtime_result<> const resumed = checkpointed::resume(options);
+
+    std::cout << "Last checkpoint after " << last.steps << " of "
+              << whole.steps << " steps, "
+              << std::filesystem::file_size(checkpoint_file) << " bytes for "
+              << last.cells.size() << " cells\n";
+    std::cout << "Without checkpoints: " << plain.steps / plain.seconds
+              << " steps/s\n";
+    std::cout << "With checkpoints:    " << whole.steps / whole.seconds
+              << " steps/s\n";
+    if (resumed.steps != whole.steps || resumed.final != whole.final
+        || resumed.tape.str() != whole.tape.str()
+        || whole.tape.str() != plain.tape.str())
+      std::cout << "The resumed run disagrees!\n";
+    else
+      std::cout << "The resumed run ends just the same\n";
+
+    try {
+      run_checkpointed<check_a, lang_prog>::resume(options);
+    } catch (std::runtime_error const& e) {
+      std::cout << "Resuming with another program: " << e.what() << '\n';
+    }
+
+    std::filesystem::remove(checkpoint_file);
+  }
+
+  std::cout << "\n";
+  std::cout << "Tracing:\n";
+  std::cout << "========\n";
 
+  {
+    std::filesystem::path const trace_file =
+      std::filesystem::temp_directory_path() / "turing-machine.trace";
+    trace_options options;
+    options.path = trace_file.string();
+    options.block = 1024;
+    options.keyframes = std::size_t{1} << 19;
+
+    runtime_result<> const plain =
+      run_runtime<put_right_marker, reverse_prog>::do_(
+        runtime_tape{bench_input}
+      );
+    runtime_result<> const traced =
+      run_traced<put_right_marker, reverse_prog>::do_(
+        runtime_tape{bench_input}, options
+      );
+
+    trace_reader reader{options.path};
+    std::cout << "-------------\n";
+    std::cout << reader.steps() << " steps in "
+              << std::filesystem::file_size(trace_file) << " bytes, "
+              << reader.blocks() << " blocks and " << reader.keyframes()
+              << " keyframes\n";
+    std::cout << "Untraced: " << plain.steps / plain.seconds << " steps/s\n";
+    std::cout << "Traced:   " << traced.steps / traced.seconds << " steps/s\n";
+
+    // Configurations taken from the trace against the machine stopped
+    // after as many steps.
+    for (std::size_t step : {std::size_t{0}, std::size_t{1000},
+                             std::size_t{1234567}, traced.steps}) {
+      checkpoint const c = reader.configuration(step);
+      resumable_machine stopped =
+        resumable_machine::start<put_right_marker, reverse_prog>(
+          runtime_tape{bench_input}
+        );
+      stopped.run_for(step);
+      std::string const tape =
+        runtime_tape::restore(c.cells, c.leftmost, c.position).str();
+      if (tape != stopped.tape().str()
+          || (step > 0 && std::string{reverse_prog::table::state_name(c.state)}
+                            != stopped.state_name()))
+        std::cout << "The trace disagrees after " << step << " steps!\n";
+    }
+
+    for (trace_step const& s : reader.records(1000, 1005))
+      std::cout << "Instruction " << s.instruction << ", wrote " << s.symbol
+                << ", moved " << s.movement << '\n';
+
+    std::filesystem::remove(trace_file);
+  }
+
+  std::cout << "\n";
+  std::cout << "Batch execution:\n";
+  std::cout << "================\n";
+
+  std::vector<std::string> const words{
+    "aaabbbccc", "abc", "", "aabcc", "aabbccc", "aabbc", "abcabc"
+  };
+  std::vector<batch_result> const verdicts =
+    run_batch<check_a, lang_prog>::do_(words, 4, true);
+  for (std::size_t i = 0; i < words.size(); ++i)
+    std::cout << '"' << words[i] << "\": "
+              << (verdicts[i].accepted ? "accepted" : "not accepted")
+              << " in state " << verdicts[i].state_name
+              << ", tape " << verdicts[i].tape << '\n';
+
+  // Words of widely varying lengths, some of them spoilt by a random symbol.
+  std::minstd_rand random;
+  std::vector<std::string> batch;
+  for (std::size_t i = 0; i < 100000; ++i) {
+    std::size_t const n = random() % 64;
+    std::string word =
+      std::string(n, 'a') + std::string(n, 'b') + std::string(n, 'c');
+    if (n > 0 && random() % 2)
+      word[random() % word.size()] = "abc"[random() % 3];
+    batch.push_back(std::move(word));
+  }
+  benchmark_batch<check_a, lang_prog>::do_(batch);
+  std::cout << "\n";
+  std::cout << "Time slicing:\n";
+  std::cout << "=============\n";
+
+  {
+    // A state at a time.
+    resumable_machine stepped =
+      resumable_machine::start<put_right_marker, reverse_prog>(
+        runtime_tape{"ab"}
+      );
+    std::cout << "-------------\n";
+    while (stepped.run_for(100, true) == slice_end::state_change)
+      std::cout << "After " << stepped.steps() << " steps in state "
+                << stepped.state_name() << '\n';
+    stepped.tape().print();
+
+    // Of three machines sharing a thread, the one of the highest priority
+    // finishes first. The one that never halts is stopped by its budget.
+    machine_scheduler scheduler{1024};
+    for (unsigned priority : {1, 2, 4})
+      scheduler.add(
+        resumable_machine::start<put_right_marker, reverse_prog>(
+          runtime_tape{long_input}
+        ),
+        priority
+      );
+    scheduler.add(
+      resumable_machine::start<ping, ping_pong_prog>(runtime_tape{"ab"}),
+      1, 100000
+    );
+    scheduler.run(1);
+    std::cout << "-------------\n";
+    for (std::size_t id : scheduler.finished())
+      std::cout << "Machine " << id << " finished after "
+                << scheduler.machine(id).steps() << " steps, "
+                << (scheduler.machine(id).halted() ? "halted" : "stopped")
+                << '\n';
+
+    std::vector<std::string> inputs;
+    for (std::size_t i = 0; i < 1000; ++i)
+      inputs.push_back(std::string(20 + random() % 180, "ab"[i % 2]));
+    benchmark_scheduler<put_right_marker, reverse_prog>::do_(inputs);
+  }
+
+  std::cout << "\n";
+  std::cout << "Enumerating programs:\n";
+  std::cout << "=====================\n";
+
+  // The busy beavers: of all machines of so many states, the ones that halt
+  // after the most steps and that leave the most ones behind.
+  for (std::size_t states = 1; states <= 4; ++states) {
+    enumeration_options options;
+    options.states = states;
+    options.undecided = false;
+
+    std::string longest;
+    std::size_t longest_steps = 0;
+    std::size_t most_ones = 0;
+    enumeration_stats const stats = enumerate_programs::do_(
+      options,
+      [&] (enumerated_program&& found) {
+        if (found.steps > longest_steps) {
+          longest = found.text();
+          longest_steps = found.steps;
+        }
+        most_ones = std::max(most_ones, found.ones);
+      }
+    );
+
+    std::cout << "-------------\n";
+    std::cout << states << " states: " << stats.machines << " machines, "
+              << stats.halted << " halt, " << stats.diverged
+              << " never halt, " << stats.undecided << " undecided ("
+              << stats.machines / stats.seconds << " machines/s)\n";
+    std::cout << "Most steps: " << longest_steps << ", most ones: "
+              << most_ones << '\n';
+    std::cout << longest;
+
+    // The same machine loaded back from its text.
+    std::istringstream text{longest};
+    runtime_result<> const again =
+      run_loaded::do_(loaded_program::parse(text), runtime_tape{""});
+    if (again.steps != longest_steps || !again.final)
+      std::cout << "The enumeration disagrees!\n";
+  }
+
+  // How the enumeration scales with the number of threads.
+  {
+    unsigned const cores = std::max(std::thread::hardware_concurrency(), 1u);
+    enumeration_options options;
+    options.states = 3;
+    std::cout << "-------------\n";
+    std::cout << "3 states on " << cores << " hardware threads:\n";
+    for (unsigned threads = 1; ; threads = std::min(2 * threads, cores)) {
+      options.threads = threads;
+      std::size_t survivors = 0;
+      enumeration_stats const stats = enumerate_programs::do_(
+        options, [&] (enumerated_program&&) { ++survivors; }
+      );
+      std::cout << threads << " threads: "
+                << stats.machines / stats.seconds << " machines/s ("
+                << survivors << " passed on)\n";
+      if (threads == cores)
+        break;
+    }
+  }
+}
+#endif